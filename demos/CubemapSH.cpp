@@ -149,13 +149,13 @@ int init()
 	tShader = new ParticleShader(true, true , "ScrollTexFire" );
 	sShader = new ParticleShader(true, true , "Sparks");
 
-	Texture* flameAlphaTex = new Texture("flameAlpha.png");
+	Texture* flameAlphaTex = new Texture("flameAlpha.dds");
 	Texture* flameDecayTex = new Texture("flameDecay.png");
 
-	Texture* sparkAlphaTex = new Texture("sparkAlpha.png");
+	Texture* sparkAlphaTex = new Texture("sparkAlpha.dds");
 	Texture* sparkDecayTex = new Texture("sparkDecay.png");
 
-	Texture* smokeAlphaTex = new Texture("smokeAlpha.png");
+	Texture* smokeAlphaTex = new Texture("smokeAlpha.dds");
 	Texture* smokeDecayTex = new Texture("smokeDecay.png");
 
 	flame = new AdvectParticlesSHCubemap(
@@ -9,6 +9,7 @@
 #include <gtc/matrix_transform.hpp>
 
 #include <limits>
+#include <chrono>
 
 /* Fire Demo
  */
@@ -35,6 +36,13 @@ const int k = 5;
 int eTime;
 int deTime;
 
+/* Frame timing, to compare pipelined and serial updates. */
+int nFrames = 0;
+float updateTime = 0.0f;
+float renderTime = 0.0f;
+std::chrono::high_resolution_clock::time_point lastFrame;
+float frameTime = 0.0f;
+
 float flameIntensity = 0.001f;
 float intensityDelta = 0.0001f;
 
@@ -75,7 +83,7 @@ int init()
 	tShader = new ParticleShader(true, true , "ScrollTexFire" );
 	sShader = new ParticleShader(true, true , "StaticTexFire");
 
-	Texture* flameAlphaTex = new Texture("flameAlpha.png");
+	Texture* flameAlphaTex = new Texture("flameAlpha.dds");
 	Texture* staticFlameAlphaTex = new Texture("staticFlameAlpha.png");
 	Texture* flameDecayTex = new Texture("flameDecay.png");
 
@@ -138,6 +146,11 @@ int init()
 
 	scene->camera->translate(glm::vec3(0.0f, 0.0f, -3.0f));
 
+	// Simulate the next frame while this one renders.
+	scene->setPipelined(true);
+	std::cout << "Press p to toggle pipelined updates." << std::endl;
+	lastFrame = std::chrono::high_resolution_clock::now();
+
 	return 1;
 }
 
@@ -147,8 +160,28 @@ void display()
 	deTime = glutGet(GLUT_ELAPSED_TIME) - eTime;
 	eTime = glutGet(GLUT_ELAPSED_TIME);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	auto start = std::chrono::high_resolution_clock::now();
 	scene->update(deTime);
+	auto updated = std::chrono::high_resolution_clock::now();
 	scene->render();
+	auto rendered = std::chrono::high_resolution_clock::now();
+
+	updateTime += std::chrono::duration<float, std::milli>(updated - start).count();
+	renderTime += std::chrono::duration<float, std::milli>(rendered - updated).count();
+	frameTime += std::chrono::duration<float, std::milli>(rendered - lastFrame).count();
+	lastFrame = rendered;
+
+	if(++nFrames == 100)
+	{
+		std::cout << (scene->isPipelined() ? "Pipelined: " : "Serial: ")
+			<< frameTime / nFrames << "ms frame, "
+			<< updateTime / nFrames << "ms in update, "
+			<< renderTime / nFrames << "ms in render.\n";
+		nFrames = 0;
+		updateTime = renderTime = frameTime = 0.0f;
+	}
+
 	glutSwapBuffers();
 	glutPostRedisplay();
 }
@@ -166,11 +199,21 @@ void keyboard(unsigned char key, int x, int y)
 {
 	scene->camera->keyboardInput(key, x, y);
 
+	// Wait for any update in progress before changing the flames.
+	scene->sync();
+
     switch (key)
     {
     case 27:
         exit(0);
         return;
+	case 'p':
+		scene->setPipelined(!scene->isPipelined());
+		// Start a new average, so that no report mixes the two.
+		nFrames = 0;
+		updateTime = renderTime = frameTime = 0.0f;
+		lastFrame = std::chrono::high_resolution_clock::now();
+		break;
 	case 't':
 		initVel += delInitVel;
 		std::cout << initVel << std::endl;
@@ -3,6 +3,7 @@
 #include "Texture.hpp"
 #include "Particles.hpp"
 #include "Mesh.hpp"
+#include "ForceField.hpp"
 
 #include <glm.hpp>
 #include <GL/glut.h>
@@ -12,6 +13,8 @@
  * This demo applies a force to the fire which varies with time. This is 
  * intended to demonstrate the way the lighting dynamically adapts to the
  * behaviour of the flame.
+ * The force is a ForceField shared by the flame and sparks: rising curl
+ * noise turbulence, and a gust swinging to and fro above the base.
  */
 
 int init();
@@ -28,6 +31,9 @@ AdvectParticles*               sparks;
 
 Mesh* bunny;
 
+ForceField* field;
+int gust;
+
 Scene* scene;
 SHLight* light;
 
@@ -58,6 +64,7 @@ int main(int argc, char** argv)
     glutMainLoop();
 
 	delete scene;
+	delete field;
 }
 
 // Called by glutInit().
@@ -88,6 +95,14 @@ int init()
 	const float sparkBBHeight = 0.03f;
 	const float sparkBBWidth = 0.03f;
 
+	/* Force Field Properties */
+	const glm::vec3 fieldMin(-1.0f, 0.0f, -1.0f);
+	const glm::vec3 fieldMax(1.0f, 3.0f, 1.0f);
+	const float curlStrength = 2e-7f;
+	const float curlScale = 1.5f;
+	const float curlSpeed = 0.3f;
+	const float gustBase = 0.5f;
+
 	/* Smoke Properties */
 	const int nSmokeParticles = 20;
 
@@ -107,13 +122,13 @@ int init()
 	tShader = new ParticleShader(true, true , "ScrollTexFire" );
 	sShader = new ParticleShader(true, true , "Sparks");
 
-	Texture* flameAlphaTex = new Texture("flameAlpha.png");
+	Texture* flameAlphaTex = new Texture("flameAlpha.dds");
 	Texture* flameDecayTex = new Texture("flameDecay.png");
 
-	Texture* sparkAlphaTex = new Texture("sparkAlpha.png");
+	Texture* sparkAlphaTex = new Texture("sparkAlpha.dds");
 	Texture* sparkDecayTex = new Texture("sparkDecay.png");
 
-	Texture* smokeAlphaTex = new Texture("smokeAlpha.png");
+	Texture* smokeAlphaTex = new Texture("smokeAlpha.dds");
 	Texture* smokeDecayTex = new Texture("smokeDecay.png");
 
 	flame = new AdvectParticlesCentroidLights(
@@ -135,6 +150,14 @@ int init()
 	sparks->bbHeight = sparkBBHeight;
 	sparks->bbWidth = sparkBBWidth;
 
+	field = new ForceField(fieldMin, fieldMax, 16, 24, 16);
+	field->setCurlNoise(curlStrength, curlScale, curlSpeed);
+	gust = field->addWind(glm::vec3(fieldMin.x, gustBase, fieldMin.z), fieldMax, glm::vec3(0.0f));
+	field->timeVarying = true;
+	field->rebuild();
+	flame->field = field;
+	sparks->field = field;
+
 	flame->translate(glm::vec3(0.0f, 0.0f, 1.0f));
 	sparks->translate(glm::vec3(0.0f, 0.0f, 1.0f));
 
@@ -166,10 +189,10 @@ void display()
 	eTime = glutGet(GLUT_ELAPSED_TIME);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	scene->update(deTime);
-	flame->extForce = glm::vec4(glm::vec3(
-		6e-7f * sin(static_cast<float>(eTime) / 1000.0f), 0.0f, 0.0f ), 0.0f);
-	sparks->extForce = glm::vec4(glm::vec3(
-		6e-7f * sin(static_cast<float>(eTime) / 1000.0f), 0.0f, 0.0f ), 0.0f);
+	// The gust changes as the field refreshes, a few slices each frame.
+	field->setWind(gust, glm::vec3(
+		6e-7f * sin(static_cast<float>(eTime) / 1000.0f), 0.0f, 0.0f));
+	field->update(deTime);
 	scene->render();
 	glutSwapBuffers();
 	glutPostRedisplay();
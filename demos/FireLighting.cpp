@@ -92,7 +92,7 @@ int init()
 		nLights = UserInput::getInt(0, GC::maxPhongLights, 
 			"Please enter desired no. of lights: ");
 
-	Texture* flameAlphaTex = new Texture("flameAlpha.png");
+	Texture* flameAlphaTex = new Texture("flameAlpha.dds");
 	Texture* flameDecayTex = new Texture("flameDecay.png");
 	ParticleShader* flameShader = new ParticleShader(true, true, "ScrollTexFire");
 
@@ -0,0 +1,287 @@
+#include "ParticleSim.hpp"
+#include "ParticleKernel.hpp"
+#include "DepthSort.hpp"
+#include "ForceField.hpp"
+#include "GC.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+
+/* Particle Benchmark
+ * Times ParticleSim::update() with no window or GL context, for each
+ *   combination of particle count, thread count and parameter set, and
+ *   reports particles per second, ns per particle, and the scaling
+ *   efficiency of each thread count relative to one thread.
+ * With -d, each step is also depth sorted as for a subtractive
+ *   system, with the view orbiting the given degrees per step, and the
+ *   sort time and how often the previous order was reused are reported.
+ * Usage: particle-bench [-n counts] [-t threads] [-p sets] [-s steps]
+ *   [-k kernel] [-d degrees], where counts, threads and sets are comma
+ *   separated, e.g. particle-bench -n 10000,100000 -t 1,2,4 -p default,respawn
+ */
+
+struct ParamSet
+{
+	const char* name;
+	const char* desc;
+	void (*apply)(ParticleSim& sim);
+};
+
+void applyDefault(ParticleSim&) {}
+
+void applyRespawn(ParticleSim& sim)
+{
+	sim.avgLifetime = 300;
+	sim.varLifetime = 100;
+	sim.avgPerturbTime = 100;
+	sim.varPerturbTime = 50;
+}
+
+void applyNoPerturb(ParticleSim& sim)
+{
+	sim.perturbOn = false;
+}
+
+void applyForces(ParticleSim& sim)
+{
+	sim.extForce = glm::vec4(0.0000002f, 0.0f, -0.0000001f, 0.0f);
+	sim.centerForce = 0.000003f;
+	sim.initVel = 0.0001f;
+}
+
+void applyEmitter(ParticleSim& sim)
+{
+	// Fill a quarter of the pool at steady state.
+	sim.respawn = false;
+	const float lifetime = sim.avgLifetime / 1000.0f;
+	sim.addEmitter(glm::vec3(0.0f), 0.25f * sim.getParticles().getSize() / lifetime);
+}
+
+void applyField(ParticleSim& sim)
+{
+	static ForceField field(glm::vec3(-1.0f, 0.0f, -1.0f), glm::vec3(1.0f, 3.0f, 1.0f), 16, 24, 16);
+	field.setCurlNoise(2e-7f, 1.5f, 0.3f);
+	field.rebuild();
+	sim.field = &field;
+}
+
+void applyLOD(ParticleSim& sim)
+{
+	sim.setLOD(0.25f);
+}
+
+const ParamSet paramSets[] =
+{
+	{"default",   "AdvectParticles defaults", applyDefault},
+	{"respawn",   "short lifetimes, frequent perturbation", applyRespawn},
+	{"noperturb", "perturbation off", applyNoPerturb},
+	{"forces",    "external and strong centering forces", applyForces},
+	{"emitter",   "pooled, an emitter keeping a quarter live", applyEmitter},
+	{"field",     "a 16x24x16 curl noise force field", applyField},
+	{"lod",       "LOD 0.25, as for a distant system", applyLOD}
+};
+const int nParamSets = sizeof(paramSets) / sizeof(ParamSet);
+
+const int dTime = 16; // ~60fps.
+const int nRepeats = 3;
+float orbitStep = 0.0f; //Degrees the view orbits per step, with -d.
+
+std::vector<std::string> split(const std::string& list);
+std::vector<int> toInts(const std::vector<std::string>& strings);
+struct SortStats
+{
+	double time; //Seconds.
+	int nReused;
+};
+
+double timeSteps(ParticleSim& sim, int nSteps, int nThreads,
+	DepthSort* sort = nullptr, SortStats* stats = nullptr);
+void usage();
+
+int main(int argc, char** argv)
+{
+	const int hwThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	std::vector<int> counts;
+	counts.push_back(10000);
+	counts.push_back(100000);
+	counts.push_back(1000000);
+	std::vector<int> threads;
+	for(int t = 1; t < hwThreads; t *= 2) threads.push_back(t);
+	threads.push_back(hwThreads);
+	std::vector<std::string> sets(1, "default");
+	int nSteps = 200;
+	bool sorted = false;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		if(i + 1 == argc) {usage(); return 1;}
+		const char* opt = argv[i];
+		std::string arg(argv[++i]);
+
+		if(!strcmp(opt, "-n")) counts = toInts(split(arg));
+		else if(!strcmp(opt, "-t")) threads = toInts(split(arg));
+		else if(!strcmp(opt, "-p")) sets = split(arg);
+		else if(!strcmp(opt, "-s")) nSteps = atoi(arg.c_str());
+		else if(!strcmp(opt, "-d"))
+		{
+			sorted = true;
+			orbitStep = static_cast<float>(atof(arg.c_str()));
+		}
+		else if(!strcmp(opt, "-k"))
+		{
+			bool found = false;
+			for(int k = ParticleKernel::SCALAR; k <= ParticleKernel::AVX2; ++k)
+				if(arg == ParticleKernel::getName(static_cast<ParticleKernel::Kernel>(k)))
+				{
+					found = ParticleKernel::setKernel(static_cast<ParticleKernel::Kernel>(k));
+					if(!found) std::cout << "!! Kernel " << arg << " is not supported by this CPU." << std::endl;
+					break;
+				}
+			if(!found) {usage(); return 1;}
+		}
+		else {usage(); return 1;}
+	}
+	if(counts.empty() || threads.empty() || nSteps < 1) {usage(); return 1;}
+
+	std::cout << "> Kernel: " << ParticleKernel::getName(ParticleKernel::getKernel())
+		<< ", " << hwThreads << " hardware threads, " << nSteps << " steps of "
+		<< dTime << "ms, best of " << nRepeats << "." << std::endl;
+#ifndef _OPENMP
+	std::cout << "!! Built without OpenMP: all thread counts will run serially." << std::endl;
+#endif
+
+	for(auto s = sets.begin(); s != sets.end(); ++s)
+	{
+		const ParamSet* set = nullptr;
+		for(int p = 0; p < nParamSets; ++p)
+			if(*s == paramSets[p].name) set = &paramSets[p];
+		if(!set)
+		{
+			std::cout << "!! Unknown parameter set " << *s << "." << std::endl;
+			continue;
+		}
+
+		std::cout << std::endl << "> Parameters: " << set->name
+			<< " (" << set->desc << ")" << std::endl;
+		std::cout << std::setw(10) << "particles" << std::setw(9) << "threads"
+			<< std::setw(12) << "ms/step" << std::setw(14) << "Mparticles/s"
+			<< std::setw(13) << "ns/particle" << std::setw(12) << "efficiency";
+		if(sorted) std::cout << std::setw(12) << "sort ms" << std::setw(9) << "reused";
+		std::cout << std::endl;
+
+		for(auto n = counts.begin(); n != counts.end(); ++n)
+		{
+			ParticleSim sim(*n);
+			set->apply(sim);
+			sim.reset();
+
+			// Run one lifetime first, so respawns reach their steady rate.
+			timeSteps(sim, sim.avgLifetime / dTime, 1);
+
+			double serialTime = 0.0;
+			for(auto t = threads.begin(); t != threads.end(); ++t)
+			{
+				DepthSort sort(*n);
+				SortStats stats, bestStats;
+				double best = timeSteps(sim, nSteps, *t, sorted ? &sort : nullptr, &bestStats);
+				for(int r = 1; r < nRepeats; ++r)
+				{
+					const double time = timeSteps(sim, nSteps, *t, sorted ? &sort : nullptr, &stats);
+					if(time < best) {best = time; bestStats = stats;}
+				}
+
+				const double secPerStep = best / nSteps;
+				const double particlesPerSec = (*n) / secPerStep;
+				if(t == threads.begin()) serialTime = secPerStep * (*t);
+				const double efficiency = serialTime / (secPerStep * (*t));
+
+				std::cout << std::fixed
+					<< std::setw(10) << *n << std::setw(9) << *t
+					<< std::setw(12) << std::setprecision(3) << secPerStep * 1e3
+					<< std::setw(14) << std::setprecision(1) << particlesPerSec * 1e-6
+					<< std::setw(13) << std::setprecision(2) << 1e9 / particlesPerSec
+					<< std::setw(11) << std::setprecision(0) << efficiency * 100.0 << "%";
+				if(sorted)
+					std::cout << std::setw(12) << std::setprecision(3) << bestStats.time / nSteps * 1e3
+						<< std::setw(8) << std::setprecision(0) << 100.0 * bestStats.nReused / nSteps << "%";
+				std::cout << std::endl;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* Returns the time taken in seconds, sort included. If sort is not
+ * null, each step is depth sorted too, and the sorts timed in stats. */
+double timeSteps(ParticleSim& sim, int nSteps, int nThreads,
+	DepthSort* sort, SortStats* stats)
+{
+	if(stats)
+	{
+		stats->time = 0.0;
+		stats->nReused = 0;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for(int i = 0; i < nSteps; ++i)
+	{
+		sim.update(dTime, nThreads);
+		if(!sort) continue;
+
+		// The view looks at the origin from an orbit about the y-axis.
+		const float angle = i * orbitStep * PI / 180.0f;
+		const glm::vec3 axis(std::sin(angle), 0.0f, std::cos(angle));
+		auto sortStart = std::chrono::high_resolution_clock::now();
+		sort->sort(sim.getParticles(), axis, nThreads);
+		auto sortEnd = std::chrono::high_resolution_clock::now();
+		stats->time += std::chrono::duration<double>(sortEnd - sortStart).count();
+		if(sort->wasReused()) ++stats->nReused;
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+std::vector<std::string> split(const std::string& list)
+{
+	std::vector<std::string> items;
+	std::istringstream stream(list);
+	std::string item;
+	while(std::getline(stream, item, ','))
+		if(!item.empty()) items.push_back(item);
+	return items;
+}
+
+std::vector<int> toInts(const std::vector<std::string>& strings)
+{
+	std::vector<int> ints;
+	for(auto s = strings.begin(); s != strings.end(); ++s)
+	{
+		int i = atoi(s->c_str());
+		if(i > 0) ints.push_back(i);
+	}
+	return ints;
+}
+
+void usage()
+{
+	std::cout << "Usage: particle-bench [-n counts] [-t threads] [-p sets] [-s steps] [-k kernel] [-d degrees]" << std::endl;
+	std::cout << ">  -n  Comma separated particle counts (default 10000,100000,1000000)." << std::endl;
+	std::cout << ">  -t  Comma separated thread counts (default powers of 2 up to the hardware threads)." << std::endl;
+	std::cout << ">  -p  Comma separated parameter sets:" << std::endl;
+	for(int p = 0; p < nParamSets; ++p)
+		std::cout << ">        " << paramSets[p].name << ": " << paramSets[p].desc << std::endl;
+	std::cout << ">  -s  Timed steps per measurement (default 200)." << std::endl;
+	std::cout << ">  -k  Kernel: scalar, SSE2 or AVX2 (default the best supported)." << std::endl;
+	std::cout << ">  -d  Depth sort each step, the view orbiting this many degrees per step." << std::endl;
+}
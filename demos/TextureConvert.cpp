@@ -0,0 +1,46 @@
+#include "Texture.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* Texture Converter
+ * Converts images in ../textures to DXT compressed, mipmapped .dds
+ *   files with Texture::compress(), for the demos to load in place
+ *   of the originals. Needs no window or GL context.
+ * Usage: texture-convert [filenames], where filenames are relative
+ *   to ../textures. With no filenames, the particle billboard
+ *   textures are converted. The decay textures are left as they
+ *   are, being small colour ramps which block compression would
+ *   only blur.
+ */
+
+const char* billboards[] =
+{
+	"flameAlpha.png",
+	"sparkAlpha.png",
+	"smokeAlpha.png"
+};
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> filenames(argv + 1, argv + argc);
+	if(filenames.empty())
+		filenames.assign(billboards, billboards + sizeof(billboards) / sizeof(billboards[0]));
+
+	int nFailed = 0;
+	for(auto f = filenames.begin(); f != filenames.end(); ++f)
+	{
+		try
+		{
+			Texture::compress(*f);
+		}
+		catch(const TextureFileException& e)
+		{
+			std::cout << "!! " << e.msg;
+			++nFailed;
+		}
+	}
+
+	return nFailed == 0 ? 0 : 1;
+}
@@ -10,6 +10,7 @@ in vec4	vPosition;
 in vec3 vNorm;
 in vec3 vBentNorm;
 in vec2 vTexCoord;
+in mat4 vInstance; //Per-instance transform, see InstanceBuffer.
 
 out vec3 smoothNorm;
 out vec3 smoothBentNorm;
@@ -17,6 +18,27 @@ out vec4 worldPos;
 out vec2 smoothTexCoord;
 
 uniform mat4 modelToWorld;
+uniform bool instanced;
+uniform bool packedVerts; //See VertexPacking.
+uniform vec3 posOffset;
+uniform vec3 posScale;
+
+vec4 decodePosition(vec4 p)
+{
+	return packedVerts ? vec4(posOffset + p.xyz * posScale, 1.0) : p;
+}
+
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if(n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * sign(n.xy);
+	return normalize(n);
+}
+
+vec3 decodeNormal(vec3 n)
+{
+	return packedVerts ? octDecode(n.xy) : n;
+}
 
 layout(std140) uniform cameraBlock
 {
@@ -27,10 +49,12 @@ layout(std140) uniform cameraBlock
 
 void main()
 {
-	smoothNorm = mat3(modelToWorld) * vNorm; //!Beware non-uniform scaling!
-	smoothBentNorm = mat3(modelToWorld) * vBentNorm;
+	mat4 model = instanced ? modelToWorld * vInstance : modelToWorld;
+
+	smoothNorm = mat3(model) * decodeNormal(vNorm); //!Beware non-uniform scaling!
+	smoothBentNorm = mat3(model) * decodeNormal(vBentNorm);
 	smoothTexCoord = vTexCoord;
-	worldPos = modelToWorld * vPosition;
+	worldPos = model * decodePosition(vPosition);
 	gl_Position = worldToCamera * worldPos;
 }
 
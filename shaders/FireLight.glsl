@@ -6,7 +6,9 @@
 -- Vertex
 #version 330
 
-in vec4 vPos;
+in float vPosX;
+in float vPosY;
+in float vPosZ;
 in float vDecay;
 
 out VertexData{
@@ -24,7 +26,7 @@ uniform mat4 rotation;
 void main()
 {
 	VertexOut.decay = vDecay;
-	gl_Position = rotation * worldToObject * modelToWorld * vPos;
+	gl_Position = rotation * worldToObject * modelToWorld * vec4(vPosX, vPosY, vPosZ, 1.0);
 }
 
 -- Geometry
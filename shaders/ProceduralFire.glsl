@@ -12,7 +12,9 @@
 
 uniform mat4 modelToWorld;
 
-in vec4 vPos;
+in float vPosX;
+in float vPosY;
+in float vPosZ;
 in float vDecay;
 in float vRandTex;
 
@@ -25,7 +27,7 @@ void main()
 {
 	VertexOut.decay = vDecay;
 	VertexOut.randTex = vRandTex;
-	gl_Position = modelToWorld * vPos;
+	gl_Position = modelToWorld * vec4(vPosX, vPosY, vPosZ, 1.0);
 }
 
 -- Geometry
@@ -9,7 +9,9 @@
 
 uniform mat4 modelToWorld;
 
-in vec4 vPos;
+in float vPosX;
+in float vPosY;
+in float vPosZ;
 in float vDecay;
 
 out VertexData{
@@ -19,7 +21,7 @@ out VertexData{
 void main()
 {
 	VertexOut.decay = vDecay;
-	gl_Position = modelToWorld * vPos;
+	gl_Position = modelToWorld * vec4(vPosX, vPosY, vPosZ, 1.0);
 }
 
 -- Geometry
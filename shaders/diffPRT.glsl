@@ -7,10 +7,20 @@
 
 in vec4 vPosition;
 in vec2 vTexCoord;
+in mat4 vInstance; //Per-instance transform, see InstanceBuffer.
 
 out vec2 smoothTex;
 
 uniform mat4 modelToWorld;
+uniform bool instanced;
+uniform bool packedVerts; //See VertexPacking.
+uniform vec3 posOffset;
+uniform vec3 posScale;
+
+vec4 decodePosition(vec4 p)
+{
+	return packedVerts ? vec4(posOffset + p.xyz * posScale, 1.0) : p;
+}
 
 layout(std140) uniform cameraBlock
 {
@@ -22,7 +32,8 @@ layout(std140) uniform cameraBlock
 void main()
 {
 	smoothTex = vTexCoord;
-	gl_Position = worldToCamera * modelToWorld * vPosition;
+	mat4 model = instanced ? modelToWorld * vInstance : modelToWorld;
+	gl_Position = worldToCamera * model * decodePosition(vPosition);
 }
 
 --Fragment
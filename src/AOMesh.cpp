@@ -1,9 +1,13 @@
 #include "AOMesh.hpp"
 
 #include "Mesh.hpp"
+#include "Scene.hpp"
 #include "Intersect.hpp"
 #include "Texture.hpp"
+#include "TextureManager.hpp"
+#include "MeshSimplifier.hpp"
 #include "SH.hpp"
+#include "GC.hpp"
 
 #include <omp.h>
 #include <iostream>
@@ -14,74 +18,164 @@
 AOMesh::AOMesh(
 	const std::string& bakedFilename,
 	LightShader* shader)
-	:Renderable(false), shader(shader)
+	:Renderable(false), shader(shader), geometry(nullptr)
 {
-	std::vector<AOMeshVertex> mesh;
-	std::vector<GLushort> elems;
-	try
-	{
-		readPrebakedFile(mesh, elems, "../models/" + bakedFilename);
-	}
-	catch(const MeshFileException& e)
+	const std::string key = "AOMesh " + bakedFilename;
+	geometry = static_cast<AOMeshGeometry*>(MeshGeometry::find(key));
+
+	if(!geometry)
 	{
-		std::cout << e.msg;
-		return;
+		std::vector<AOMeshVertex> mesh;
+		std::vector<std::vector<GLuint>> levels(1);
+		try
+		{
+			readPrebakedFile(mesh, levels, "../models/" + bakedFilename);
+		}
+		catch(const MeshFileException& e)
+		{
+			std::cout << e.msg;
+			return;
+		}
+
+		AOMeshGeometry* geom = createGeometry(mesh, levels);
+		geom->ambTex = ambTex;
+		geom->diffTex = diffTex;
+		geom->specTex = specTex;
+		geom->specExp = specExp;
+		geometry = static_cast<AOMeshGeometry*>(MeshGeometry::share(key, geom));
 	}
-	init(mesh, elems);
+
+	ambTex = geometry->ambTex;
+	diffTex = geometry->diffTex;
+	specTex = geometry->specTex;
+	specExp = geometry->specExp;
+
+	init();
 }
 
-void AOMesh::init(
+AOMeshGeometry* AOMesh::createGeometry(
 		const std::vector<AOMeshVertex>& mesh,
-		const std::vector<GLushort>& elems)
+		const std::vector<std::vector<GLuint>>& levels)
 {
-	numElems = elems.size();
+	AOMeshGeometry* geom = new AOMeshGeometry();
+	geom->packed = GC::packVertices;
+
+	std::vector<glm::vec4> verts;
+	for(auto v = mesh.begin(); v != mesh.end(); ++v)
+		verts.push_back(v->v);
+
+	glGenBuffers(1, &geom->v_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, geom->v_vbo);
+
+	if(GC::packVertices)
+	{
+		geom->posBounds = VertexPacking::bounds(verts);
+
+		std::vector<PackedAOMeshVertex> packed(mesh.size());
+		for(unsigned i = 0; i < mesh.size(); ++i)
+		{
+			VertexPacking::packPosition(mesh[i].v, geom->posBounds, packed[i].v);
+			VertexPacking::packNormal(mesh[i].n, packed[i].n);
+			VertexPacking::packNormal(mesh[i].bn, packed[i].bn);
+			VertexPacking::packTexCoord(mesh[i].t, packed[i].t);
+		}
+
+		glBufferData(GL_ARRAY_BUFFER, sizeof(PackedAOMeshVertex) * packed.size(),
+			packed.data(), GL_STATIC_DRAW);
+		VertexPacking::reportSaving("AOMesh", mesh.size(), 
+			sizeof(PackedAOMeshVertex), sizeof(AOMeshVertex));
+	}
+	else
+		glBufferData(GL_ARRAY_BUFFER, sizeof(AOMeshVertex) * mesh.size(),
+			mesh.data(), GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	geom->lods.init(levels, verts);
 
+	return geom;
+}
+
+void AOMesh::init()
+{
 	shader->setAmbTexUnit(ambTex->getTexUnit());
 	shader->setDiffTexUnit(diffTex->getTexUnit());
 	shader->setSpecTexUnit(specTex->getTexUnit());
 	shader->setSpecExp(specExp);
 
-	glGenBuffers(1, &v_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, v_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(AOMeshVertex) * mesh.size(),
-		mesh.data(), GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glGenBuffers(1, &e_vbo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, e_vbo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * elems.size(),
-		elems.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
 	v_attrib = shader->getAttribLoc("vPosition");
 	n_attrib = shader->getAttribLoc("vNorm");
 	bn_attrib = shader->getAttribLoc("vBentNorm");
 	t_attrib = shader->getAttribLoc("vTexCoord");
+	inst_attrib = shader->findAttribLoc("vInstance");
 
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao);
 
-	glBindBuffer(GL_ARRAY_BUFFER, v_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, geometry->v_vbo);
 	glEnableVertexAttribArray(v_attrib);
 	glEnableVertexAttribArray(n_attrib);
 	glEnableVertexAttribArray(bn_attrib);
 	glEnableVertexAttribArray(t_attrib);
-	glVertexAttribPointer(v_attrib, 4, GL_FLOAT, GL_FALSE, sizeof(AOMeshVertex),
-		reinterpret_cast<GLvoid*>(offsetof(AOMeshVertex, v)));
-	glVertexAttribPointer(n_attrib, 3, GL_FLOAT, GL_FALSE, sizeof(AOMeshVertex), 
-		reinterpret_cast<GLvoid*>(offsetof(AOMeshVertex, n)));
-	glVertexAttribPointer(bn_attrib, 3, GL_FLOAT, GL_FALSE, sizeof(AOMeshVertex), 
-		reinterpret_cast<GLvoid*>(offsetof(AOMeshVertex, bn)));
-	glVertexAttribPointer(t_attrib, 2, GL_FLOAT, GL_FALSE, sizeof(AOMeshVertex), 
-		reinterpret_cast<GLvoid*>(offsetof(AOMeshVertex, t)));
+	if(GC::packVertices)
+	{
+		glVertexAttribPointer(v_attrib, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedAOMeshVertex),
+			reinterpret_cast<GLvoid*>(offsetof(PackedAOMeshVertex, v)));
+		glVertexAttribPointer(n_attrib, 2, GL_SHORT, GL_TRUE, sizeof(PackedAOMeshVertex), 
+			reinterpret_cast<GLvoid*>(offsetof(PackedAOMeshVertex, n)));
+		glVertexAttribPointer(bn_attrib, 2, GL_SHORT, GL_TRUE, sizeof(PackedAOMeshVertex), 
+			reinterpret_cast<GLvoid*>(offsetof(PackedAOMeshVertex, bn)));
+		glVertexAttribPointer(t_attrib, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedAOMeshVertex), 
+			reinterpret_cast<GLvoid*>(offsetof(PackedAOMeshVertex, t)));
+	}
+	else
+	{
+		glVertexAttribPointer(v_attrib, 4, GL_FLOAT, GL_FALSE, sizeof(AOMeshVertex),
+			reinterpret_cast<GLvoid*>(offsetof(AOMeshVertex, v)));
+		glVertexAttribPointer(n_attrib, 3, GL_FLOAT, GL_FALSE, sizeof(AOMeshVertex), 
+			reinterpret_cast<GLvoid*>(offsetof(AOMeshVertex, n)));
+		glVertexAttribPointer(bn_attrib, 3, GL_FLOAT, GL_FALSE, sizeof(AOMeshVertex), 
+			reinterpret_cast<GLvoid*>(offsetof(AOMeshVertex, bn)));
+		glVertexAttribPointer(t_attrib, 2, GL_FLOAT, GL_FALSE, sizeof(AOMeshVertex), 
+			reinterpret_cast<GLvoid*>(offsetof(AOMeshVertex, t)));
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if(inst_attrib != -1) instances.attach(inst_attrib);
 
 	glBindVertexArray(0);
 }
 
+void AOMesh::setInstances(const std::vector<glm::mat4>& transforms)
+{
+	if(inst_attrib == -1 && !transforms.empty())
+	{
+		std::cout << "Shader " << shader->filename << " does not support instancing.\n";
+		return;
+	}
+	instances.set(transforms);
+}
+
+bool AOMesh::getWorldBounds(BoundingVolume& bounds)
+{
+	if(!geometry) return false;
+
+	if(instances.size() > 0)
+		bounds = instances.bounds(geometry->lods.getBounds()).transformed(modelToWorld);
+	else
+		bounds = geometry->lods.getBounds().transformed(modelToWorld);
+
+	return true;
+}
+
 void AOMesh::render()
 {
-	if(!scene) return;
+	if(!scene || !geometry) return;
 	
 	shader->setModelToWorld(modelToWorld);
+	shader->setPackedVerts(GC::packVertices, 
+		geometry->posBounds.offset, geometry->posBounds.scale);
+	shader->setInstanced(instances.size() > 0);
 
 	shader->setAmbTexUnit(ambTex->getTexUnit());
 	shader->setDiffTexUnit(diffTex->getTexUnit());
@@ -91,14 +185,14 @@ void AOMesh::render()
 	shader->use();
 
 	glBindVertexArray(vao);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, e_vbo);
 
-	glDrawElements(GL_TRIANGLES, (GLsizei) numElems, GL_UNSIGNED_SHORT, 0);
+	if(instances.size() > 0)
+		instances.draw(geometry->lods, modelToWorld, scene->camera);
+	else
+		geometry->lods.draw(geometry->lods.select(modelToWorld, scene->camera));
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
-
-	glUseProgram(0);
 }
 
 void AOMesh::bake(
@@ -113,6 +207,45 @@ void AOMesh::bake(
 {
 	MeshData coarseData = Mesh::loadSceneFile(coarseMeshFilename);
 	MeshData fineData = Mesh::loadSceneFile(fineMeshFilename);
+
+	bakeMeshes(coarseData, fineData, bakedFilename, 
+		ambTex, diffTex, specTex, specExp, sqrtNSamples);
+}
+
+void AOMesh::bake(
+	const std::string& meshFilename,
+	size_t coarseTris,
+	const std::string& bakedFilename,
+	const std::string& ambTex,
+	const std::string& diffTex,
+	const std::string& specTex,
+	float specExp,
+	int sqrtNSamples)
+{
+	MeshData fineData = Mesh::loadSceneFile(meshFilename);
+
+	std::cout << "> Simplifying " << fineData.e.size() / 3 
+		<< " triangles to a coarse mesh of " << coarseTris << "..." << std::endl;
+	MeshData coarseData = MeshSimplifier::extract(fineData, 
+		MeshSimplifier::simplify(fineData, fineData.e, coarseTris));
+	Mesh::buildLODs(coarseData);
+	std::cout << "> Coarse mesh has " << coarseData.e.size() / 3 
+		<< " triangles." << std::endl;
+
+	bakeMeshes(coarseData, fineData, bakedFilename, 
+		ambTex, diffTex, specTex, specExp, sqrtNSamples);
+}
+
+void AOMesh::bakeMeshes(
+	const MeshData& coarseData,
+	const MeshData& fineData,
+	const std::string& bakedFilename,
+	const std::string& ambTex,
+	const std::string& diffTex,
+	const std::string& specTex,
+	float specExp,
+	int sqrtNSamples)
+{
 	std::vector<AOMeshVertex> mesh(coarseData.v.size());
 
 	int tid;
@@ -166,7 +299,7 @@ void AOMesh::bake(
 					glm::vec3 tb = glm::vec3(coarseData.v[coarseData.e[t+1]]);
 					glm::vec3 tc = glm::vec3(coarseData.v[coarseData.e[t+2]]);
 
-					if(triangleRayIntersect(ta, tb, tc, glm::vec3(fineData.v[i]), dir))
+					if(triangleRayIntersect(ta, tb, tc, glm::vec3(coarseData.v[i]), dir))
 					{
 						intersect = true;
 						break; // No need to check other triangles.
@@ -274,7 +407,10 @@ void AOMesh::bake(
 	AOMesh::renderOcclToImage(fineOccl, ambTex, 
 		"../textures/" + bakedFilename + ".aoamb.bmp", fineData);
 
-	writePrebakedFile(mesh, coarseData.e,
+	std::vector<std::vector<GLuint>> levels(1, coarseData.e);
+	levels.insert(levels.end(), coarseData.lods.begin(), coarseData.lods.end());
+
+	writePrebakedFile(mesh, levels,
 		bakedFilename + ".aoamb.bmp", bakedFilename + ".aoamb.bmp", specTex, specExp,
 		"../models/" + bakedFilename + ".ao");
 }
@@ -282,7 +418,7 @@ void AOMesh::bake(
 
 void AOMesh::writePrebakedFile(
 		const std::vector<AOMeshVertex>& mesh,
-		const std::vector<GLushort>& elems,
+		const std::vector<std::vector<GLuint>>& levels,
 		const std::string& ambTex,
 		const std::string& diffTex,
 		const std::string& specTex,
@@ -315,8 +451,12 @@ void AOMesh::writePrebakedFile(
 
 	file << "Elements" << std::endl;
 
-	for(auto e = elems.begin(); e != elems.end(); ++e)
-		file << *e << std::endl;
+	for(auto l = levels.begin(); l != levels.end(); ++l)
+	{
+		if(l != levels.begin()) file << "LOD Elements" << std::endl;
+		for(auto e = l->begin(); e != l->end(); ++e)
+			file << *e << std::endl;
+	}
 
 	file << "Textures" << std::endl;
 
@@ -330,7 +470,7 @@ void AOMesh::writePrebakedFile(
 
 void AOMesh::readPrebakedFile(
 	std::vector<AOMeshVertex>& mesh,
-	std::vector<GLushort>& elems,
+	std::vector<std::vector<GLuint>>& levels,
  	const std::string& filename)
 {
 	std::ifstream file(filename);
@@ -338,9 +478,9 @@ void AOMesh::readPrebakedFile(
 	if(!file) throw(MeshFileException(
 		"Prebaked mesh file " + filename + " could not be found.\n"));
 
-	char ignore[10];
+	char ignore[30];
 
-	file.getline(ignore, 10); //Throw the "Vertices" line.
+	file.getline(ignore, 30); //Throw the "Vertices" line.
 
 	float next;
 
@@ -368,28 +508,36 @@ void AOMesh::readPrebakedFile(
 	}
 
 	file.clear();
-	file.getline(ignore, 10); //Throw the "Elements" line.
+	file.getline(ignore, 30); //Throw the "Elements" line.
 
-	int elem;
+	GLuint elem;
 	while(file >> elem)
-		elems.push_back(static_cast<GLushort>(elem));
+		levels[0].push_back(elem);
 
+	/* Any coarser LODs follow, each under its own header. */
 	file.clear();
-	file.getline(ignore, 10); //Throw the "Textures" line.
+	file.getline(ignore, 30);
+	while(std::string(ignore) == "LOD Elements")
+	{
+		levels.push_back(std::vector<GLuint>());
+		while(file >> elem)
+			levels.back().push_back(elem);
+		file.clear();
+		file.getline(ignore, 30);
+	}
+	//ignore now holds the "Textures" line.
 
 	char readFilename[40];
 
 	file.getline(readFilename, 40);
-	ambTex = new Texture(std::string(readFilename));
+	ambTex = TextureManager::request(std::string(readFilename));
 	file.getline(readFilename, 40);
-	diffTex = new Texture(std::string(readFilename));
+	diffTex = TextureManager::request(std::string(readFilename));
 	file.getline(readFilename, 40);
-	specTex = new Texture(std::string(readFilename));
+	specTex = TextureManager::request(std::string(readFilename));
 
 	file >> specExp;
 
-	numElems = elems.size();
-
 	file.close();
 }
 
@@ -457,8 +605,7 @@ void AOMesh::renderOcclToImage(
 	GLuint elem_ebo;
 	glGenBuffers(1, &elem_ebo);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elem_ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort)*data.e.size(),
-		data.e.data(), GL_STATIC_DRAW);
+	GLenum elemType = bufferElements(data.e);
 	
 	// Rendering setup
 	// Store current state
@@ -484,7 +631,7 @@ void AOMesh::renderOcclToImage(
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 	// Render
-	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(data.e.size()), GL_UNSIGNED_SHORT, 0);
+	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(data.e.size()), elemType, 0);
 
 	// Rendering cleanup
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
@@ -493,7 +640,7 @@ void AOMesh::renderOcclToImage(
 	glDeleteBuffers(1, &tex_vbo);
 	glDeleteBuffers(1, &occl_vbo);
 	glDeleteBuffers(1, &elem_ebo);
-	glUseProgram(0);
+	Shader::unbind();
 	//Restore old state
 	if(faceCull == GL_TRUE) glEnable(GL_CULL_FACE);
 	else glDisable(GL_CULL_FACE);
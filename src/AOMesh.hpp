@@ -3,6 +3,8 @@
 
 #include "Renderable.hpp"
 #include "Shader.hpp"
+#include "MeshGeometry.hpp"
+#include "InstanceBuffer.hpp"
 
 #include <GL/glut.h>
 
@@ -20,12 +22,35 @@ struct AOMeshVertex
 	glm::vec2  t; //Tex coord
 };
 
+struct PackedAOMeshVertex
+{
+	GLushort v[4];  //Quantised position
+	GLshort  n[2];  //Octahedral normal
+	GLshort  bn[2]; //Octahedral bent normal
+	GLhalf   t[2];  //Tex coord
+};
+
+/* AOMeshGeometry
+ * Geometry shared by AOMeshes loaded from the same prebaked
+ *   file, along with the material the file specifies.
+ */
+struct AOMeshGeometry : public MeshGeometry
+{
+	Texture* ambTex;
+	Texture* diffTex;
+	Texture* specTex;
+	float specExp;
+};
+
 /* AOMesh
  * Class representing an object rendered using
  * AO and Blinn-Phong shading. 
  * Intended to be used by first calling bake() to
  * create a pre-baked file, and then loading this
  * via the constructor to create AOMesh objects.
+ * The pre-baked file also stores the mesh's LODs.
+ * AOMeshes loaded from the same file share their geometry, and
+ * one AOMesh can draw many copies of itself via setInstances().
  */
 class AOMesh : public Renderable
 {
@@ -44,9 +69,25 @@ public:
 		float specExp,
 		int sqrtNSamples);
 
+	/* As above, but generates the coarse mesh by simplifying the
+	 * fine mesh to at most coarseTris triangles. Every occlusion
+	 * ray is tested against every coarse triangle, so coarseTris
+	 * trades bake time against accuracy.
+	 */
+	static void bake(
+		const std::string& meshFilename,
+		size_t coarseTris,
+		const std::string& bakedFilename,
+		const std::string& ambTex,
+		const std::string& diffTex,
+		const std::string& specTex,
+		float specExp,
+		int sqrtNSamples);
+
+	/* levels holds the element lists of each LOD, from finest. */
 	static void writePrebakedFile(
 		const std::vector<AOMeshVertex>& mesh,
-		const std::vector<GLushort>& elems,
+		const std::vector<std::vector<GLuint>>& levels,
 		const std::string& ambTex,
 		const std::string& diffTex,
 		const std::string& specTex,
@@ -56,14 +97,30 @@ public:
 	void render();
 	void update(int dTime) {};
 	Shader* getShader() {return shader;};
+	GLuint getVAO() {return vao;};
+	bool getWorldBounds(BoundingVolume& bounds);
+	const void* getTextureSet() {return geometry;};
+
+	/* As Mesh::setInstances(). */
+	void setInstances(const std::vector<glm::mat4>& transforms);
 private:
+	static void bakeMeshes(
+		const MeshData& coarseData,
+		const MeshData& fineData,
+		const std::string& bakedFilename,
+		const std::string& ambTex,
+		const std::string& diffTex,
+		const std::string& specTex,
+		float specExp,
+		int sqrtNSamples);
 	void readPrebakedFile(
 		std::vector<AOMeshVertex>& mesh,
-		std::vector<GLushort>& elems,
+		std::vector<std::vector<GLuint>>& levels,
 	 	const std::string& filename);
-	void init(
+	static AOMeshGeometry* createGeometry(
 		const std::vector<AOMeshVertex>& mesh,
-		const std::vector<GLushort>& elems);
+		const std::vector<std::vector<GLuint>>& levels);
+	void init();
 	static void renderOcclToImage(
 		const std::vector<float>& vertOccl,
 		const std::string& ambIm,
@@ -71,7 +128,8 @@ private:
 		const MeshData& data);
 
 	LightShader* shader;
-	size_t numElems;
+	AOMeshGeometry* geometry;
+	InstanceBuffer instances;
 
 	Texture* ambTex;
 	Texture* diffTex;
@@ -79,12 +137,11 @@ private:
 	float specExp;
 
 	GLuint vao;
-	GLuint v_vbo;
-	GLuint e_vbo;
 	GLuint v_attrib;
 	GLuint n_attrib;
 	GLuint bn_attrib;
 	GLuint t_attrib;
+	GLint inst_attrib;
 };
 
 #endif
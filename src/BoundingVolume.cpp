@@ -0,0 +1,70 @@
+#include "BoundingVolume.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+BoundingVolume::BoundingVolume()
+	:centre(0.0f), radius(0.0f), halfAxes(0.0f)
+{}
+
+BoundingVolume BoundingVolume::fromPoints(const std::vector<glm::vec4>& points)
+{
+	if(points.empty()) return BoundingVolume();
+
+	glm::vec3 minP(points[0]), maxP(points[0]);
+	for(auto p = points.begin(); p != points.end(); ++p)
+	{
+		minP = glm::min(minP, glm::vec3(*p));
+		maxP = glm::max(maxP, glm::vec3(*p));
+	}
+
+	BoundingVolume b = fromBox(minP, maxP);
+
+	/* A sphere about the box centre through the furthest point
+	 * is often tighter than the box's circumsphere. */
+	b.radius = 0.0f;
+	for(auto p = points.begin(); p != points.end(); ++p)
+		b.radius = std::max(b.radius, glm::length(glm::vec3(*p) - b.centre));
+
+	return b;
+}
+
+BoundingVolume BoundingVolume::fromBox(const glm::vec3& min, const glm::vec3& max)
+{
+	BoundingVolume b;
+	glm::vec3 half = (max - min) * 0.5f;
+
+	b.centre = (min + max) * 0.5f;
+	b.halfAxes = glm::mat3(0.0f);
+	for(int i = 0; i < 3; ++i)
+		b.halfAxes[i][i] = half[i];
+	b.radius = glm::length(half);
+
+	return b;
+}
+
+BoundingVolume BoundingVolume::transformed(const glm::mat4& transform) const
+{
+	BoundingVolume b;
+	glm::mat3 linear(transform);
+
+	b.centre = glm::vec3(transform * glm::vec4(centre, 1.0f));
+	b.halfAxes = linear * halfAxes;
+
+	float scale = std::max(glm::length(linear[0]),
+		std::max(glm::length(linear[1]), glm::length(linear[2])));
+	b.radius = radius * scale;
+
+	return b;
+}
+
+void BoundingVolume::getExtents(glm::vec3& min, glm::vec3& max) const
+{
+	glm::vec3 extent(0.0f);
+	for(int axis = 0; axis < 3; ++axis)
+		for(int i = 0; i < 3; ++i)
+			extent[i] += fabs(halfAxes[axis][i]);
+
+	min = centre - extent;
+	max = centre + extent;
+}
@@ -0,0 +1,31 @@
+#ifndef BOUNDINGVOLUME_HPP
+#define BOUNDINGVOLUME_HPP
+
+#include <glm.hpp>
+
+#include <vector>
+
+/* BoundingVolume
+ * A bounding sphere and box, used for frustum culling.
+ * Bounds are built in model space as an AABB and a sphere, both
+ *   about the same centre. transformed() takes them to world 
+ *   space, where the box is oriented, so it is stored as three
+ *   half-axes (the columns of halfAxes).
+ */
+struct BoundingVolume
+{
+	BoundingVolume();
+
+	static BoundingVolume fromPoints(const std::vector<glm::vec4>& points);
+	static BoundingVolume fromBox(const glm::vec3& min, const glm::vec3& max);
+
+	BoundingVolume transformed(const glm::mat4& transform) const;
+	/* The world space AABB enclosing the box. */
+	void getExtents(glm::vec3& min, glm::vec3& max) const;
+
+	glm::vec3 centre;
+	float radius;
+	glm::mat3 halfAxes;
+};
+
+#endif
@@ -1,9 +1,12 @@
 #include "Camera.hpp"
 
 #include "Shader.hpp"
+#include "BoundingVolume.hpp"
+#include "GC.hpp"
 
 #include <gtc/matrix_transform.hpp>
 #include <iostream>
+#include <algorithm>
 
 const float Camera::moveDelta = 0.4f;
 const float Camera::rotDelta = 1.6f;
@@ -16,9 +19,11 @@ Camera::Camera()
 
 {
 	projection = glm::perspective(FOV, aspect, zNear, zFar);
-	block.worldToCamera = projection * translation * rotation;
+	worldToView = translation * rotation;
+	block.worldToCamera = projection * worldToView;
 	block.cameraDir = glm::vec4(0.0, 0.0, -1.0, 1.0);
 	block.cameraPos = glm::vec4(0.0, 0.0, 0.0, 1.0);
+	updateFrustum();
 
 	glGenBuffers(1, &cameraBlock_ubo);
 	glBindBufferRange(GL_UNIFORM_BUFFER, 
@@ -89,6 +94,35 @@ void Camera::setZFar(const float& newZFar)
 	updateBlock();
 }
 
+float Camera::screenSize(const glm::vec3& centre, float radius)
+{
+	glm::vec3 viewCentre(worldToView * glm::vec4(centre, 1.0f));
+	float dist = glm::length(viewCentre);
+
+	if(dist <= radius) return 1.0f;
+
+	return std::min(1.0f, radius / (dist * tanf(FOV * PI / 360.0f)));
+}
+
+bool Camera::inFrustum(const BoundingVolume& bounds)
+{
+	for(int i = 0; i < 6; ++i)
+	{
+		glm::vec3 n(frustum[i]);
+		float dist = glm::dot(n, bounds.centre) + frustum[i].w;
+		if(dist < -bounds.radius) return false;
+		if(dist >= bounds.radius) continue;
+
+		/* Sphere straddles the plane, so try the box's projected radius. */
+		float boxRadius = 
+			fabs(glm::dot(n, bounds.halfAxes[0])) +
+			fabs(glm::dot(n, bounds.halfAxes[1])) +
+			fabs(glm::dot(n, bounds.halfAxes[2]));
+		if(dist < -boxRadius) return false;
+	}
+	return true;
+}
+
 void Camera::keyboardInput(unsigned char key, int x, int y)
 {
 	if(mode == CENTERED)
@@ -172,9 +206,12 @@ void Camera::updateRotation()
 void Camera::updateBlock()
 {
 	if(mode == CENTERED)
-		block.worldToCamera = projection * translation * rotation;
+		worldToView = translation * rotation;
 	else if(mode == FREELOOK)
-		block.worldToCamera = projection * rotation * translation;
+		worldToView = rotation * translation;
+
+	block.worldToCamera = projection * worldToView;
+	updateFrustum();
 
 	glm::mat4 inv = glm::inverse(block.worldToCamera);
 	block.cameraPos = glm::vec4(inv[3][0], inv[3][1], inv[3][2], 1.0);
@@ -192,3 +229,22 @@ void Camera::reset()
 	setRot(0.0, 0.0);
 	setPos(glm::vec3(0.0, 0.0, 2.0));
 }
+
+void Camera::updateFrustum()
+{
+	/* Planes from the rows of the clip matrix (Gribb & Hartmann). */
+	const glm::mat4& m = block.worldToCamera;
+	glm::vec4 row[4];
+	for(int r = 0; r < 4; ++r)
+		row[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+
+	frustum[0] = row[3] + row[0]; //Left
+	frustum[1] = row[3] - row[0]; //Right
+	frustum[2] = row[3] + row[1]; //Bottom
+	frustum[3] = row[3] - row[1]; //Top
+	frustum[4] = row[3] + row[2]; //Near
+	frustum[5] = row[3] - row[2]; //Far
+
+	for(int i = 0; i < 6; ++i)
+		frustum[i] /= glm::length(glm::vec3(frustum[i]));
+}
@@ -5,6 +5,8 @@
 
 #include <GL/glew.h>
 
+struct BoundingVolume;
+
 /* Camera Modes
  * FREELOOK: Camera rotates & moves relative to itself.
  * CENTRED: Camera rotates around (0,0,0).
@@ -42,13 +44,28 @@ public:
 	void mouseInput(int mouseX, int mouseY);
 
 	CameraBlock& getBlock() {return block;};
+	const glm::mat4& getWorldToView() {return worldToView;};
+	float getFOV() {return FOV;};
+
+	/* Returns the fraction of the screen height covered by a sphere
+	 * in world space, or 1 if the camera is inside it.
+	 */
+	float screenSize(const glm::vec3& centre, float radius);
+
+	/* Returns false if world space bounds lie wholly outside the
+	 * view frustum. Tests the sphere, then the box. Conservative: 
+	 * a few bounds outside the frustum near its corners pass.
+	 */
+	bool inFrustum(const BoundingVolume& bounds);
 private:
 	CameraModes mode;
 	glm::mat4 projection;
+	glm::mat4 worldToView;
 	glm::mat4 translation;
 	glm::mat4 rotation;
 	
 	CameraBlock block;
+	glm::vec4 frustum[6]; //Planes (n, d) with normals facing inwards.
 	GLuint cameraBlock_ubo;
 
 	float theta;
@@ -61,6 +78,7 @@ private:
 	int lastMouseY;
 	void updateRotation();
 	void updateBlock();
+	void updateFrustum();
 	void reset();
 	static const float moveDelta;
 	static const float rotDelta;
@@ -0,0 +1,231 @@
+#include "DDS.hpp"
+
+#include "Texture.hpp"
+
+#include "image_DXT.h"
+
+#include <fstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+
+namespace
+{
+	const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+	const uint32_t FOURCC_DXT1 = 0x31545844;
+	const uint32_t FOURCC_DXT3 = 0x33545844;
+	const uint32_t FOURCC_DXT5 = 0x35545844;
+
+	/* Header flags */
+	const uint32_t DDSD_REQUIRED = 0x1 | 0x2 | 0x4 | 0x1000; // Caps, height, width, pixel format.
+	const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+	const uint32_t DDSD_LINEARSIZE = 0x80000;
+	const uint32_t DDPF_FOURCC = 0x4;
+	const uint32_t DDSCAPS_COMPLEX = 0x8;
+	const uint32_t DDSCAPS_TEXTURE = 0x1000;
+	const uint32_t DDSCAPS_MIPMAP = 0x400000;
+
+	/* Word offsets into the 124 byte header */
+	enum HeaderWord
+	{
+		SIZE = 0, FLAGS = 1, HEIGHT = 2, WIDTH = 3, LINEAR_SIZE = 4,
+		MIPMAP_COUNT = 6, PF_SIZE = 18, PF_FLAGS = 19, PF_FOURCC = 20,
+		CAPS = 26, HEADER_WORDS = 31
+	};
+
+	/* Halves an 8-bit image in each dimension with a box filter. */
+	std::vector<unsigned char> downsample(const std::vector<unsigned char>& src,
+		int width, int height, int channels)
+	{
+		int w = width  > 1 ? width  / 2 : 1;
+		int h = height > 1 ? height / 2 : 1;
+		std::vector<unsigned char> dst(w * h * channels);
+
+		for(int v = 0; v < h; ++v)
+			for(int u = 0; u < w; ++u)
+			{
+				int u0 = std::min(2*u, width-1),  u1 = std::min(2*u + 1, width-1);
+				int v0 = std::min(2*v, height-1), v1 = std::min(2*v + 1, height-1);
+				for(int c = 0; c < channels; ++c)
+				{
+					int sum = 
+						src[(u0 + v0*width)*channels + c] + src[(u1 + v0*width)*channels + c] +
+						src[(u0 + v1*width)*channels + c] + src[(u1 + v1*width)*channels + c];
+					dst[(u + v*w)*channels + c] = static_cast<unsigned char>((sum + 2) / 4);
+				}
+			}
+
+		return dst;
+	}
+
+	/* Expands grey and grey+alpha images to RGB and RGBA, the only
+	 * layouts SOIL's DXT encoders accept. */
+	std::vector<unsigned char> expandGrey(const unsigned char* data,
+		int nPixels, int channels)
+	{
+		if(channels >= 3) return std::vector<unsigned char>(data, data + nPixels * channels);
+
+		std::vector<unsigned char> dst(nPixels * (channels + 2));
+		for(int p = 0; p < nPixels; ++p)
+		{
+			unsigned char* out = &dst[p * (channels + 2)];
+			out[0] = out[1] = out[2] = data[p * channels];
+			if(channels == 2) out[3] = data[p * channels + 1];
+		}
+
+		return dst;
+	}
+}
+
+bool DDS::isDDSFile(const std::string& filename)
+{
+	if(filename.size() < 4) return false;
+	std::string ext = filename.substr(filename.size() - 4);
+	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	return ext == ".dds";
+}
+
+int DDS::nMipLevels(int width, int height)
+{
+	int levels = 1;
+	while(width > 1 || height > 1)
+	{
+		width  = width  > 1 ? width  / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+		++levels;
+	}
+	return levels;
+}
+
+size_t DDS::levelSize(GLenum format, int width, int height)
+{
+	size_t blockSize = (format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ||
+		format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) ? 8 : 16;
+	return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+}
+
+CompressedImage DDS::read(const std::string& filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+
+	if(!file) throw(TextureFileException(
+		"Texture file " + filename + " could not be found.\n"));
+
+	uint32_t magic;
+	uint32_t header[HEADER_WORDS];
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+
+	if(!file || magic != DDS_MAGIC || header[SIZE] != sizeof(header)) 
+		throw(TextureFileException(
+			"Texture file " + filename + " is not a valid DDS file.\n"));
+
+	CompressedImage image;
+	image.width = static_cast<int>(header[WIDTH]);
+	image.height = static_cast<int>(header[HEIGHT]);
+
+	if(!(header[PF_FLAGS] & DDPF_FOURCC)) throw(TextureFileException(
+		"Texture file " + filename + " is not block compressed.\n"));
+
+	switch(header[PF_FOURCC])
+	{
+	case FOURCC_DXT1:
+		image.format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		break;
+	case FOURCC_DXT3:
+		image.format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+		break;
+	case FOURCC_DXT5:
+		image.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		break;
+	default:
+		throw(TextureFileException(
+			"Texture file " + filename + " uses an unsupported DDS format.\n"));
+	}
+
+	int nLevels = (header[FLAGS] & DDSD_MIPMAPCOUNT) && header[MIPMAP_COUNT] > 0 ?
+		static_cast<int>(header[MIPMAP_COUNT]) : 1;
+
+	int w = image.width, h = image.height;
+	for(int l = 0; l < nLevels; ++l)
+	{
+		std::vector<unsigned char> level(levelSize(image.format, w, h));
+		file.read(reinterpret_cast<char*>(level.data()), level.size());
+		if(!file) throw(TextureFileException(
+			"Texture file " + filename + " is truncated.\n"));
+		image.levels.push_back(level);
+
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+	}
+
+	return image;
+}
+
+void DDS::write(const CompressedImage& image, const std::string& filename)
+{
+	uint32_t header[HEADER_WORDS];
+	memset(header, 0, sizeof(header));
+
+	header[SIZE] = sizeof(header);
+	header[FLAGS] = DDSD_REQUIRED | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+	header[HEIGHT] = image.height;
+	header[WIDTH] = image.width;
+	header[LINEAR_SIZE] = static_cast<uint32_t>(image.levels[0].size());
+	header[MIPMAP_COUNT] = static_cast<uint32_t>(image.levels.size());
+	header[PF_SIZE] = 32;
+	header[PF_FLAGS] = DDPF_FOURCC;
+	header[PF_FOURCC] = 
+		image.format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? FOURCC_DXT5 :
+		image.format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT ? FOURCC_DXT3 :
+		FOURCC_DXT1;
+	header[CAPS] = DDSCAPS_TEXTURE | DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+
+	std::ofstream file(filename, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	for(auto l = image.levels.begin(); l != image.levels.end(); ++l)
+		file.write(reinterpret_cast<const char*>(l->data()), l->size());
+	file.close();
+}
+
+CompressedImage DDS::compress(const unsigned char* data,
+	int width, int height, int channels)
+{
+	bool alpha = (channels == 2 || channels == 4);
+
+	CompressedImage image;
+	image.width = width;
+	image.height = height;
+	image.format = alpha ? 
+		GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+
+	std::vector<unsigned char> level = expandGrey(data, width * height, channels);
+	if(channels < 3) channels += 2;
+	int w = width, h = height;
+	int nLevels = nMipLevels(width, height);
+
+	for(int l = 0; l < nLevels; ++l)
+	{
+		int size = 0;
+		unsigned char* dxt = alpha ?
+			convert_image_to_DXT5(level.data(), w, h, channels, &size) :
+			convert_image_to_DXT1(level.data(), w, h, channels, &size);
+		if(!dxt) throw(TextureFileException(
+			"DXT compression of a " + std::to_string(static_cast<long long>(w)) + "x" +
+			std::to_string(static_cast<long long>(h)) + " image failed.\n"));
+		image.levels.push_back(std::vector<unsigned char>(dxt, dxt + size));
+		free(dxt);
+
+		if(l + 1 < nLevels)
+		{
+			level = downsample(level, w, h, channels);
+			w = w > 1 ? w / 2 : 1;
+			h = h > 1 ? h / 2 : 1;
+		}
+	}
+
+	return image;
+}
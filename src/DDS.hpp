@@ -0,0 +1,46 @@
+#ifndef DDS_HPP
+#define DDS_HPP
+
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+
+/* CompressedImage
+ * A block-compressed (S3TC) image with a full chain of
+ * precomputed mipmap levels, levels[0] being the largest.
+ */
+struct CompressedImage
+{
+	GLenum format;
+	int width;
+	int height;
+	std::vector<std::vector<unsigned char>> levels;
+};
+
+/* DDS
+ * Reading and writing of DirectDraw Surface files holding
+ *   DXT1/DXT3/DXT5 compressed images with mipmaps. 
+ * Images written by DDS::write() store rows bottom-up, matching
+ *   textures loaded with SOIL_FLAG_INVERT_Y, so they can be 
+ *   uploaded without flipping.
+ */
+namespace DDS
+{
+	CompressedImage read(const std::string& filename);
+	void write(const CompressedImage& image, const std::string& filename);
+
+	/* Builds a mipmap chain from 8-bit image data and compresses each
+	 * level, using DXT5 if the image has an alpha channel, else DXT1.
+	 * Grey images (1 or 2 channels) are expanded to RGB(A) first.
+	 * Throws TextureFileException if a level cannot be compressed.
+	 */
+	CompressedImage compress(const unsigned char* data,
+		int width, int height, int channels);
+
+	bool isDDSFile(const std::string& filename);
+	int nMipLevels(int width, int height);
+	size_t levelSize(GLenum format, int width, int height);
+}
+
+#endif
@@ -0,0 +1,200 @@
+#include "DepthSort.hpp"
+
+#include "ParticleStore.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const int chunkSize = 16384;
+	const int radixBits = 11;
+	const int radix = 1 << radixBits;
+	/* Insertion sort moves allowed per particle before falling back to
+	 * the radix sort, which costs about the same, and the fraction of
+	 * particles out of order past which it is not tried at all. */
+	const int maxMoves = 2;
+	const int maxOutOfOrder = 8;
+}
+
+DepthSort::DepthSort(int size)
+	:order(size), nSorted(0), reused(false),
+	 keys(size), tmpKeys(size), tmpOrder(size)
+{
+	for(int i = 0; i < size; ++i) order[i] = i;
+}
+
+void DepthSort::sort(const ParticleStore& particles, const glm::vec3& axis,
+	int nThreads, unsigned* out)
+{
+	const int n = particles.getNLive();
+
+	/* Bring the previous order up to date with the live range, dropping
+	 * particles since removed, and adding new ones at the end. */
+	if(n != nSorted)
+	{
+		int kept = 0;
+		for(int i = 0; i < nSorted; ++i)
+			if(order[i] < static_cast<unsigned>(n)) order[kept++] = order[i];
+		for(int i = nSorted; i < n; ++i) order[kept++] = i;
+		nSorted = n;
+	}
+
+	makeKeys(particles, axis, n, nThreads);
+
+	reused = insertionSort(n);
+	if(!reused)
+	{
+		/* Sort the previous order, as left by insertionSort(), with its
+		 * keys, so the stable radix sort keeps ties in that order. */
+		keys.swap(tmpKeys);
+		radixSort(n, nThreads);
+	}
+
+	if(out && n > 0) memcpy(out, &order[0], n * sizeof(unsigned));
+}
+
+/* Keys are indexed by particle, so are computed in a single pass
+ * over the streams. */
+void DepthSort::makeKeys(const ParticleStore& particles, const glm::vec3& axis,
+	int n, int nThreads)
+{
+	const int nChunks = (n + chunkSize - 1) / chunkSize;
+	if(nChunks == 0) return;
+	chunkMin.resize(nChunks);
+	chunkMax.resize(nChunks);
+
+	/* Depths go in tmpKeys, as floats, until the range is known. */
+	float* depths = reinterpret_cast<float*>(&tmpKeys[0]);
+
+	#pragma omp parallel for num_threads(nThreads) if(nThreads > 1)
+	for(int c = 0; c < nChunks; ++c)
+	{
+		const int begin = c * chunkSize;
+		const int end = std::min(begin + chunkSize, n);
+		float lo = axis.x * particles.px[begin] +
+			axis.y * particles.py[begin] + axis.z * particles.pz[begin];
+		float hi = lo;
+		for(int i = begin; i < end; ++i)
+		{
+			const float d = axis.x * particles.px[i] +
+				axis.y * particles.py[i] + axis.z * particles.pz[i];
+			depths[i] = d;
+			lo = std::min(lo, d);
+			hi = std::max(hi, d);
+		}
+		chunkMin[c] = lo;
+		chunkMax[c] = hi;
+	}
+
+	const float lo = *std::min_element(chunkMin.begin(), chunkMin.end());
+	const float hi = *std::max_element(chunkMax.begin(), chunkMax.end());
+	const float maxKey = static_cast<float>((1 << keyBits) - 1);
+	const float scale = hi > lo ? maxKey / (hi - lo) : 0.0f;
+
+	#pragma omp parallel for num_threads(nThreads) if(nThreads > 1)
+	for(int c = 0; c < nChunks; ++c)
+	{
+		const int end = std::min((c + 1) * chunkSize, n);
+		for(int i = c * chunkSize; i < end; ++i)
+			keys[i] = static_cast<unsigned>(std::min(maxKey, (depths[i] - lo) * scale));
+	}
+}
+
+/* Sorts the previous order, with its keys gathered into tmpKeys.
+ * Returns false if it is far from sorted, or sorting it would take
+ * more than maxMoves per particle, leaving order partly sorted, and
+ * tmpKeys still holding the key of each entry. */
+bool DepthSort::insertionSort(int n)
+{
+	if(n == 0) return true;
+
+	unsigned* sortKeys = &tmpKeys[0];
+	int outOfOrder = 0;
+	sortKeys[0] = keys[order[0]];
+	for(int i = 1; i < n; ++i)
+	{
+		sortKeys[i] = keys[order[i]];
+		outOfOrder += sortKeys[i] < sortKeys[i - 1];
+	}
+	if(outOfOrder > n / maxOutOfOrder) return false;
+
+	long long budget = static_cast<long long>(maxMoves) * n;
+	for(int i = 1; i < n; ++i)
+	{
+		const unsigned key = sortKeys[i];
+		if(sortKeys[i - 1] <= key) continue;
+
+		const unsigned index = order[i];
+		int j = i;
+		do
+		{
+			sortKeys[j] = sortKeys[j - 1];
+			order[j] = order[j - 1];
+			--j;
+			--budget;
+		}
+		while(j > 0 && sortKeys[j - 1] > key && budget > 0);
+		sortKeys[j] = key;
+		order[j] = index;
+
+		if(budget <= 0) return false;
+	}
+	return true;
+}
+
+/* Sorts order by keys, which must be in the same order.
+ * Least significant digit first, radixBits at a time. Each pass counts
+ * digits per chunk in parallel, then scatters each chunk in parallel
+ * to its own offsets within each bucket, so the sort is stable. */
+void DepthSort::radixSort(int n, int nThreads)
+{
+	const int nChunks = (n + chunkSize - 1) / chunkSize;
+	counts.resize(nChunks * radix);
+
+	for(int shift = 0; shift < keyBits; shift += radixBits)
+	{
+		#pragma omp parallel for num_threads(nThreads) if(nThreads > 1)
+		for(int c = 0; c < nChunks; ++c)
+		{
+			unsigned* count = &counts[c * radix];
+			std::fill(count, count + radix, 0u);
+			const int end = std::min((c + 1) * chunkSize, n);
+			for(int i = c * chunkSize; i < end; ++i)
+				++count[(keys[i] >> shift) & (radix - 1)];
+		}
+
+		/* Turn counts into offsets. A pass with every key in one bucket
+		 * would change nothing, so is skipped. */
+		unsigned offset = 0;
+		bool oneBucket = false;
+		for(int b = 0; b < radix; ++b)
+		{
+			const unsigned start = offset;
+			for(int c = 0; c < nChunks; ++c)
+			{
+				unsigned& count = counts[c * radix + b];
+				const unsigned chunkCount = count;
+				count = offset;
+				offset += chunkCount;
+			}
+			if(offset - start == static_cast<unsigned>(n)) oneBucket = true;
+		}
+		if(oneBucket) continue;
+
+		#pragma omp parallel for num_threads(nThreads) if(nThreads > 1)
+		for(int c = 0; c < nChunks; ++c)
+		{
+			unsigned* offsets = &counts[c * radix];
+			const int end = std::min((c + 1) * chunkSize, n);
+			for(int i = c * chunkSize; i < end; ++i)
+			{
+				const unsigned dst = offsets[(keys[i] >> shift) & (radix - 1)]++;
+				tmpKeys[dst] = keys[i];
+				tmpOrder[dst] = order[i];
+			}
+		}
+		keys.swap(tmpKeys);
+		order.swap(tmpOrder);
+	}
+}
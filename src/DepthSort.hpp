@@ -0,0 +1,62 @@
+#ifndef DEPTHSORT_HPP
+#define DEPTHSORT_HPP
+
+#include <glm.hpp>
+
+#include <vector>
+
+class ParticleStore;
+
+/* DepthSort
+ * Orders the live particles of a ParticleStore back to front, for
+ *   drawing alpha-blended particles as indexed points.
+ * Depth is measured along axis, smallest (farthest) first: for model
+ *   space positions, axis is row 2 of the model to view matrix.
+ * Depths are quantised to keyBits over their range, finer than any
+ *   visible difference; ties keep their previous order.
+ * When little has moved since the last frame, e.g. a slow camera over
+ *   slow smoke, the previous order is nearly sorted, and sort() just
+ *   insertion sorts it. If that would take more than a few moves per
+ *   particle, or too many are out of order to try, it falls back to a
+ *   parallel LSD radix sort.
+ * Makes no GL calls, so it may be run on update threads.
+ */
+class DepthSort
+{
+public:
+	static const int keyBits = 22;
+
+	/* Starts with every particle in index order. */
+	DepthSort(int size);
+
+	/* Sorts on up to nThreads OpenMP threads. If out is not null, the
+	 * order is copied there too, e.g. to a mapped index buffer. */
+	void sort(const ParticleStore& particles, const glm::vec3& axis,
+		int nThreads = 1, unsigned* out = 0);
+
+	/* Particle indices, size entries, of which the first getNSorted()
+	 * are the last order sorted. */
+	const unsigned* getOrder() const {return &order[0];};
+	int getNSorted() const {return nSorted;};
+	/* Whether the last sort() was able to reuse the previous order. */
+	bool wasReused() const {return reused;};
+private:
+	std::vector<unsigned> order;
+	int nSorted;
+	bool reused;
+
+	/* Keys, and scratch space for both them and order. */
+	std::vector<unsigned> keys;
+	std::vector<unsigned> tmpKeys;
+	std::vector<unsigned> tmpOrder;
+	std::vector<unsigned> counts;
+	std::vector<float> chunkMin;
+	std::vector<float> chunkMax;
+
+	void makeKeys(const ParticleStore& particles, const glm::vec3& axis,
+		int n, int nThreads);
+	bool insertionSort(int n);
+	void radixSort(int n, int nThreads);
+};
+
+#endif
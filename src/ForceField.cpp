@@ -0,0 +1,212 @@
+#include "ForceField.hpp"
+
+#include "GC.hpp"
+
+#include <cmath>
+
+namespace
+{
+	unsigned hash(int x, int y, int z, unsigned seed)
+	{
+		unsigned h = static_cast<unsigned>(x) * 73856093u ^
+			static_cast<unsigned>(y) * 19349663u ^
+			static_cast<unsigned>(z) * 83492791u ^ seed;
+		h ^= h >> 13;
+		h *= 0x5bd1e995u;
+		h ^= h >> 15;
+		return h;
+	}
+
+	/* Dot product with one of the 12 cube edge directions. */
+	float grad(unsigned h, float x, float y, float z)
+	{
+		switch(h % 12)
+		{
+		case 0:  return  x + y;
+		case 1:  return -x + y;
+		case 2:  return  x - y;
+		case 3:  return -x - y;
+		case 4:  return  x + z;
+		case 5:  return -x + z;
+		case 6:  return  x - z;
+		case 7:  return -x - z;
+		case 8:  return  y + z;
+		case 9:  return -y + z;
+		case 10: return  y - z;
+		default: return -y - z;
+		}
+	}
+
+	float fade(float t)
+	{
+		return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+	}
+
+	float lerp(float a, float b, float t)
+	{
+		return a + t * (b - a);
+	}
+
+	/* Gradient noise, in about [-1, 1]. */
+	float noise(const glm::vec3& p, unsigned seed)
+	{
+		const float fx = std::floor(p.x), fy = std::floor(p.y), fz = std::floor(p.z);
+		const int x = static_cast<int>(fx), y = static_cast<int>(fy), z = static_cast<int>(fz);
+		const float dx = p.x - fx, dy = p.y - fy, dz = p.z - fz;
+		const float u = fade(dx), v = fade(dy), w = fade(dz);
+
+		return lerp(
+			lerp(
+				lerp(grad(hash(x, y, z, seed), dx, dy, dz),
+					grad(hash(x + 1, y, z, seed), dx - 1.0f, dy, dz), u),
+				lerp(grad(hash(x, y + 1, z, seed), dx, dy - 1.0f, dz),
+					grad(hash(x + 1, y + 1, z, seed), dx - 1.0f, dy - 1.0f, dz), u), v),
+			lerp(
+				lerp(grad(hash(x, y, z + 1, seed), dx, dy, dz - 1.0f),
+					grad(hash(x + 1, y, z + 1, seed), dx - 1.0f, dy, dz - 1.0f), u),
+				lerp(grad(hash(x, y + 1, z + 1, seed), dx, dy - 1.0f, dz - 1.0f),
+					grad(hash(x + 1, y + 1, z + 1, seed), dx - 1.0f, dy - 1.0f, dz - 1.0f), u), v),
+			w);
+	}
+}
+
+ForceField::ForceField(const glm::vec3& min, const glm::vec3& max, int nx, int ny, int nz)
+	:timeVarying(false), slicesPerUpdate(2),
+	 min(min), max(max),
+	 nx(std::max(2, nx)), ny(std::max(2, ny)), nz(std::max(2, nz)),
+	 nextSlice(0), nextTime(0.0f), time(0.0f),
+	 curlStrength(0.0f), curlScale(1.0f), curlSpeed(0.0f)
+{
+	nPoints = this->nx * this->ny * this->nz;
+	cellSize = (max - min) / glm::vec3(
+		static_cast<float>(this->nx - 1),
+		static_cast<float>(this->ny - 1),
+		static_cast<float>(this->nz - 1));
+	invCellSize = glm::vec3(1.0f) / cellSize;
+
+	grid.assign(3 * nPoints, 0.0f);
+	nextGrid.assign(3 * nPoints, 0.0f);
+}
+
+void ForceField::setCurlNoise(float strength, float scale, float speed)
+{
+	curlStrength = strength;
+	curlScale = scale;
+	curlSpeed = speed;
+}
+
+int ForceField::addWind(const glm::vec3& min, const glm::vec3& max, const glm::vec3& acn)
+{
+	Wind w;
+	w.min = min;
+	w.max = max;
+	w.acn = acn;
+	winds.push_back(w);
+	return static_cast<int>(winds.size()) - 1;
+}
+
+void ForceField::setWind(int index, const glm::vec3& acn)
+{
+	winds[index].acn = acn;
+}
+
+int ForceField::addObstacle(const glm::vec3& centre, float radius, float strength)
+{
+	Obstacle o;
+	o.centre = centre;
+	o.radius = radius;
+	o.strength = strength;
+	obstacles.push_back(o);
+	return static_cast<int>(obstacles.size()) - 1;
+}
+
+void ForceField::setObstacle(int index, const glm::vec3& centre)
+{
+	obstacles[index].centre = centre;
+}
+
+void ForceField::rebuild(int nThreads)
+{
+	evaluateSlices(grid, 0, nz, time, nThreads);
+	nextSlice = 0;
+}
+
+void ForceField::update(int dTime, int nThreads)
+{
+	time += dTime;
+	if(!timeVarying) return;
+
+	if(nextSlice == 0) nextTime = time;
+	const int end = std::min(nextSlice + std::max(1, slicesPerUpdate), nz);
+	evaluateSlices(nextGrid, nextSlice, end, nextTime, nThreads);
+	nextSlice = end;
+
+	if(nextSlice == nz)
+	{
+		grid.swap(nextGrid);
+		nextSlice = 0;
+	}
+}
+
+void ForceField::evaluateSlices(std::vector<float>& target, int begin, int end,
+	float when, int nThreads) const
+{
+	#pragma omp parallel for num_threads(nThreads) if(nThreads > 1)
+	for(int z = begin; z < end; ++z)
+		for(int y = 0; y < ny; ++y)
+			for(int x = 0; x < nx; ++x)
+			{
+				const int i = x + nx * (y + ny * z);
+				const glm::vec3 p = min + cellSize * glm::vec3(
+					static_cast<float>(x), static_cast<float>(y), static_cast<float>(z));
+				const glm::vec3 a = evaluate(p, when);
+				target[i] = a.x;
+				target[nPoints + i] = a.y;
+				target[2 * nPoints + i] = a.z;
+			}
+}
+
+glm::vec3 ForceField::evaluate(const glm::vec3& p, float when) const
+{
+	glm::vec3 acn(0.0f);
+
+	if(curlStrength != 0.0f)
+	{
+		// Scroll the noise upward, with the flames.
+		const glm::vec3 scroll(0.0f, curlSpeed * when / 1000.0f, 0.0f);
+		acn += curlStrength * curlNoise((p - scroll) * curlScale);
+	}
+
+	for(auto w = winds.begin(); w != winds.end(); ++w)
+		if(p.x >= w->min.x && p.y >= w->min.y && p.z >= w->min.z &&
+			p.x <= w->max.x && p.y <= w->max.y && p.z <= w->max.z)
+			acn += w->acn;
+
+	for(auto o = obstacles.begin(); o != obstacles.end(); ++o)
+	{
+		const glm::vec3 d = p - o->centre;
+		const float dist = glm::length(d);
+		if(dist < o->radius && dist > EPS)
+			acn += d * (o->strength * (1.0f - dist / o->radius) / dist);
+	}
+
+	return acn;
+}
+
+/* Curl of a vector potential of three noise fields, by central
+ * differences, so the flow neither gathers nor thins particles. */
+glm::vec3 ForceField::curlNoise(const glm::vec3& p) const
+{
+	const float e = 0.01f;
+	const glm::vec3 dx(e, 0.0f, 0.0f), dy(0.0f, e, 0.0f), dz(0.0f, 0.0f, e);
+	const unsigned s1 = 1, s2 = 2, s3 = 3;
+
+	const float dP3dy = noise(p + dy, s3) - noise(p - dy, s3);
+	const float dP2dz = noise(p + dz, s2) - noise(p - dz, s2);
+	const float dP1dz = noise(p + dz, s1) - noise(p - dz, s1);
+	const float dP3dx = noise(p + dx, s3) - noise(p - dx, s3);
+	const float dP2dx = noise(p + dx, s2) - noise(p - dx, s2);
+	const float dP1dy = noise(p + dy, s1) - noise(p - dy, s1);
+
+	return glm::vec3(dP3dy - dP2dz, dP1dz - dP3dx, dP2dx - dP1dy) / (2.0f * e);
+}
@@ -0,0 +1,139 @@
+#ifndef FORCEFIELD_HPP
+#define FORCEFIELD_HPP
+
+#include <glm.hpp>
+
+#include <vector>
+#include <algorithm>
+
+/* ForceField
+ * A grid of accelerations over a box in particle (model) space, for
+ *   ParticleSim::field. Particles are pushed by the field trilinearly
+ *   interpolated at their position; outside the box it is clamped to
+ *   the nearest face.
+ * The field is the sum of its layers, in units/ms^2 like initAcn:
+ *   curl noise, a divergence-free turbulence which scrolls upward at
+ *   curlSpeed units/s; wind, constant within boxes; and obstacles,
+ *   which push particles out of spheres, harder towards the centre.
+ * Layers are evaluated into the grid by rebuild(), or, if the field
+ *   is time varying, a few slices at a time by each update(), into a
+ *   second grid which replaces the first once complete. Neither may be
+ *   called while a particle system using the field is updating, e.g.
+ *   call them between Scene updates.
+ * The grid is stored as three streams of x, y and z components, x
+ *   varying fastest, so the particle kernels can gather from it.
+ */
+class ForceField
+{
+public:
+	/* A grid of nx * ny * nz points spanning min to max. Each must be
+	 * at least 2. The field starts at zero, with no layers. */
+	ForceField(const glm::vec3& min, const glm::vec3& max, int nx, int ny, int nz);
+
+	/* strength 0 turns the noise off. scale is in features per unit. */
+	void setCurlNoise(float strength, float scale, float speed);
+	/* Returns the index of the new wind or obstacle. */
+	int addWind(const glm::vec3& min, const glm::vec3& max, const glm::vec3& acn);
+	void setWind(int index, const glm::vec3& acn);
+	int addObstacle(const glm::vec3& centre, float radius, float strength);
+	void setObstacle(int index, const glm::vec3& centre);
+
+	/* Evaluates the whole grid now, on up to nThreads OpenMP threads. */
+	void rebuild(int nThreads = 1);
+	/* Advances time by dTime ms, refreshing slicesPerUpdate z slices
+	 * of the grid if time varying. */
+	void update(int dTime, int nThreads = 1);
+
+	/* The layers at p at the field's current time, without the grid. */
+	glm::vec3 evaluate(const glm::vec3& p) const {return evaluate(p, time);};
+	/* Interpolates the grid, exactly as the particle kernels do. */
+	inline glm::vec3 sample(float x, float y, float z) const;
+
+	bool timeVarying;
+	int slicesPerUpdate;
+
+	/* Grid, for the particle kernels */
+	const glm::vec3& getMin() const {return min;};
+	const glm::vec3& getInvCellSize() const {return invCellSize;};
+	int getNX() const {return nx;};
+	int getNY() const {return ny;};
+	int getNZ() const {return nz;};
+	const float* getX() const {return &grid[0];};
+	const float* getY() const {return &grid[nPoints];};
+	const float* getZ() const {return &grid[2 * nPoints];};
+private:
+	ForceField(const ForceField&);
+	ForceField& operator=(const ForceField&);
+
+	struct Wind
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+		glm::vec3 acn;
+	};
+	struct Obstacle
+	{
+		glm::vec3 centre;
+		float radius;
+		float strength;
+	};
+
+	glm::vec3 min;
+	glm::vec3 max;
+	int nx, ny, nz;
+	int nPoints;
+	glm::vec3 cellSize;
+	glm::vec3 invCellSize;
+
+	std::vector<float> grid;
+	std::vector<float> nextGrid; //Being refreshed by update().
+	int nextSlice;  //Next z slice of nextGrid to refresh.
+	float nextTime; //Time nextGrid is being evaluated at.
+	float time;     //ms.
+
+	float curlStrength;
+	float curlScale;
+	float curlSpeed;
+	std::vector<Wind> winds;
+	std::vector<Obstacle> obstacles;
+
+	glm::vec3 evaluate(const glm::vec3& p, float when) const;
+	glm::vec3 curlNoise(const glm::vec3& p) const;
+	void evaluateSlices(std::vector<float>& target, int begin, int end,
+		float when, int nThreads) const;
+};
+
+/* Each step here is mirrored by ParticleKernelSIMD::sampleField(). */
+inline glm::vec3 ForceField::sample(float x, float y, float z) const
+{
+	/* Grid coordinates, clamped to the grid, and the cell they fall in,
+	 * clamped so the last point is the far corner of the last cell. */
+	const float gx = std::min(std::max((x - min.x) * invCellSize.x, 0.0f), static_cast<float>(nx - 1));
+	const float gy = std::min(std::max((y - min.y) * invCellSize.y, 0.0f), static_cast<float>(ny - 1));
+	const float gz = std::min(std::max((z - min.z) * invCellSize.z, 0.0f), static_cast<float>(nz - 1));
+	const float cx = static_cast<float>(static_cast<int>(std::min(gx, static_cast<float>(nx - 2))));
+	const float cy = static_cast<float>(static_cast<int>(std::min(gy, static_cast<float>(ny - 2))));
+	const float cz = static_cast<float>(static_cast<int>(std::min(gz, static_cast<float>(nz - 2))));
+	const float tx = gx - cx, ty = gy - cy, tz = gz - cz;
+	const int i = static_cast<int>(cx + static_cast<float>(nx) * (cy + static_cast<float>(ny) * cz));
+
+	const int corners[8] = {i, i + 1, i + nx, i + nx + 1,
+		i + nx * ny, i + nx * ny + 1, i + nx * ny + nx, i + nx * ny + nx + 1};
+	const float* streams[3] = {getX(), getY(), getZ()};
+	float result[3];
+	for(int s = 0; s < 3; ++s)
+	{
+		float c[8];
+		for(int k = 0; k < 8; ++k) c[k] = streams[s][corners[k]];
+		const float a00 = c[0] + tx * (c[1] - c[0]);
+		const float a10 = c[2] + tx * (c[3] - c[2]);
+		const float a01 = c[4] + tx * (c[5] - c[4]);
+		const float a11 = c[6] + tx * (c[7] - c[6]);
+		const float b0 = a00 + ty * (a10 - a00);
+		const float b1 = a01 + ty * (a11 - a01);
+		result[s] = b0 + tz * (b1 - b0);
+	}
+	return glm::vec3(result[0], result[1], result[2]);
+}
+
+#endif
@@ -22,6 +22,30 @@ namespace GC
 	const int cubemapSize = 256;
 	const int cubemapPixels = cubemapSize * cubemapSize;
 
+	/* Textures */
+	const float textureUploadBudget = 2.0f; //ms of texture uploads per frame.
+
+	/* Meshes */
+	const bool packVertices = false; //Quantise vertex data (see VertexPacking, Main.cpp -v).
+	const int vertexCacheSize = 32; //Post-transform cache entries optimised for.
+	const bool optimiseOverdraw = false;
+	const int nLODs = 4;
+	const float lodTriRatio = 0.25f; //Triangles in each LOD relative to the last.
+	const float lodFullDetailSize = 0.5f; //Screen height fraction drawn with LOD 0.
+
+	/* Updates */
+	const int updateThreads = 0; //Threads used by Scene::update(), 0 for one per core.
+	const bool pipelineFrames = false; //Default for Scene::setPipelined().
+
+	/* Particles */
+	const float particleStepRate = 120.0f; //Fixed simulation steps per second.
+	const float minParticleStepRate = 60.0f;
+	const float maxParticleStepRate = 240.0f;
+	const int maxParticleSubsteps = 8; //Steps per frame, beyond which time is dropped.
+	const float particleFullDetailSize = 0.25f; //Screen height fraction simulated with every particle.
+	const float minParticleLOD = 0.05f; //Least fraction of particles LOD keeps.
+	const float maxParticleLODStep = 50.0f; //ms, longest LOD may lengthen steps to.
+
 	/* AO */
 	const int sqrtAOSamples = 10;
 	const int nAOSamples = sqrtAOSamples * sqrtAOSamples / 2;
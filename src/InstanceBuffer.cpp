@@ -0,0 +1,85 @@
+#include "InstanceBuffer.hpp"
+
+#include "LODChain.hpp"
+
+InstanceBuffer::InstanceBuffer()
+	:vbo(0), capacity(0), dirty(false)
+{}
+
+InstanceBuffer::~InstanceBuffer()
+{
+	if(vbo) glDeleteBuffers(1, &vbo);
+}
+
+void InstanceBuffer::set(const std::vector<glm::mat4>& transforms)
+{
+	this->transforms = transforms;
+	dirty = true;
+}
+
+void InstanceBuffer::set(size_t i, const glm::mat4& transform)
+{
+	transforms[i] = transform;
+	dirty = true;
+}
+
+void InstanceBuffer::attach(GLuint attrib)
+{
+	if(!vbo) glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+	for(GLuint col = 0; col < 4; ++col)
+	{
+		glEnableVertexAttribArray(attrib + col);
+		glVertexAttribPointer(attrib + col, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+			reinterpret_cast<GLvoid*>(sizeof(glm::vec4) * col));
+		glVertexAttribDivisor(attrib + col, 1);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::draw(const LODChain& lods, const glm::mat4& modelToWorld, Camera* camera)
+{
+	if(transforms.empty()) return;
+	upload();
+	lods.drawInstanced(lods.select(modelToWorld, transforms, camera),
+		static_cast<GLsizei>(transforms.size()));
+}
+
+BoundingVolume InstanceBuffer::bounds(const BoundingVolume& b) const
+{
+	if(transforms.empty()) return b;
+
+	glm::vec3 minB, maxB;
+	b.transformed(transforms[0]).getExtents(minB, maxB);
+
+	for(auto t = transforms.begin() + 1; t != transforms.end(); ++t)
+	{
+		glm::vec3 minI, maxI;
+		b.transformed(*t).getExtents(minI, maxI);
+		minB = glm::min(minB, minI);
+		maxB = glm::max(maxB, maxI);
+	}
+
+	return BoundingVolume::fromBox(minB, maxB);
+}
+
+void InstanceBuffer::upload()
+{
+	if(!dirty || !vbo) return;
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	if(transforms.size() > capacity)
+	{
+		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * transforms.size(),
+			transforms.data(), GL_DYNAMIC_DRAW);
+		capacity = transforms.size();
+	}
+	else
+		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::mat4) * transforms.size(),
+			transforms.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	dirty = false;
+}
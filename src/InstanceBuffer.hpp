@@ -0,0 +1,53 @@
+#ifndef INSTANCEBUFFER_HPP
+#define INSTANCEBUFFER_HPP
+
+#include "BoundingVolume.hpp"
+
+#include <glm.hpp>
+#include <GL/glew.h>
+
+#include <vector>
+
+class LODChain;
+class Camera;
+
+/* InstanceBuffer
+ * Per-instance transforms for drawing many copies of a mesh in
+ *   one glDrawElementsInstanced call.
+ * attach() adds the transforms to the bound VAO as a mat4
+ *   attribute (four consecutive locations) with a divisor of 1.
+ *   The shader applies each before the Renderable's modelToWorld.
+ * Changes are only uploaded when the instances are next drawn.
+ */
+class InstanceBuffer
+{
+public:
+	InstanceBuffer();
+	~InstanceBuffer();
+
+	void set(const std::vector<glm::mat4>& transforms);
+	void set(size_t i, const glm::mat4& transform);
+	void attach(GLuint attrib);
+
+	/* Draws every instance at a single LOD, chosen for the instance
+	 * closest to the camera. The owning VAO must be bound. */
+	void draw(const LODChain& lods, const glm::mat4& modelToWorld, Camera* camera);
+
+	/* Bounds enclosing every instance of a mesh with bounds b. */
+	BoundingVolume bounds(const BoundingVolume& b) const;
+
+	size_t size() const {return transforms.size();};
+	const std::vector<glm::mat4>& getTransforms() const {return transforms;};
+private:
+	InstanceBuffer(const InstanceBuffer&);
+	InstanceBuffer& operator=(const InstanceBuffer&);
+
+	void upload();
+
+	GLuint vbo;
+	std::vector<glm::mat4> transforms;
+	size_t capacity; //Number of transforms vbo has room for.
+	bool dirty;
+};
+
+#endif
@@ -0,0 +1,86 @@
+#include "LODChain.hpp"
+
+#include "Mesh.hpp"
+#include "Camera.hpp"
+#include "GC.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+LODChain::LODChain()
+	:e_vbo(0), elemType(GL_UNSIGNED_SHORT)
+{}
+
+LODChain::~LODChain()
+{
+	if(e_vbo) glDeleteBuffers(1, &e_vbo);
+}
+
+void LODChain::init(
+	const std::vector<std::vector<GLuint>>& levels,
+	const std::vector<glm::vec4>& verts)
+{
+	std::vector<GLuint> elems;
+	offsets.clear();
+	counts.clear();
+
+	for(auto l = levels.begin(); l != levels.end(); ++l)
+	{
+		if(l->empty()) continue;
+		offsets.push_back(elems.size());
+		counts.push_back(l->size());
+		elems.insert(elems.end(), l->begin(), l->end());
+	}
+
+	if(!e_vbo) glGenBuffers(1, &e_vbo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, e_vbo);
+	elemType = bufferElements(elems);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	const size_t elemSize = elemType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	for(auto o = offsets.begin(); o != offsets.end(); ++o)
+		*o *= elemSize;
+
+	bounds = BoundingVolume::fromPoints(verts);
+}
+
+int LODChain::select(const glm::mat4& modelToWorld, Camera* camera) const
+{
+	if(counts.size() < 2 || !camera) return 0;
+
+	BoundingVolume world = bounds.transformed(modelToWorld);
+	float size = camera->screenSize(world.centre, world.radius);
+
+	if(size >= GC::lodFullDetailSize) return 0;
+	if(size <= 0.0f) return nLevels() - 1;
+
+	int level = static_cast<int>(log(GC::lodFullDetailSize / size) / log(2.0f));
+	return std::min(level, nLevels() - 1);
+}
+
+int LODChain::select(const glm::mat4& modelToWorld,
+	const std::vector<glm::mat4>& instances, Camera* camera) const
+{
+	int level = nLevels() - 1;
+	for(auto i = instances.begin(); i != instances.end() && level > 0; ++i)
+		level = std::min(level, select(modelToWorld * *i, camera));
+	return std::max(level, 0);
+}
+
+void LODChain::draw(int level) const
+{
+	if(counts.empty()) return;
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, e_vbo);
+	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(counts[level]), elemType,
+		reinterpret_cast<GLvoid*>(offsets[level]));
+}
+
+void LODChain::drawInstanced(int level, GLsizei nInstances) const
+{
+	if(counts.empty()) return;
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, e_vbo);
+	glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(counts[level]), elemType,
+		reinterpret_cast<GLvoid*>(offsets[level]), nInstances);
+}
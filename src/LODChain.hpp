@@ -0,0 +1,51 @@
+#ifndef LODCHAIN_HPP
+#define LODCHAIN_HPP
+
+#include "BoundingVolume.hpp"
+
+#include <glm.hpp>
+#include <GL/glew.h>
+
+#include <vector>
+
+class Camera;
+
+/* LODChain
+ * Element lists for one vertex buffer at decreasing levels of
+ *   detail, concatenated into a single element buffer.
+ * select() chooses a level from the fraction of the screen height
+ *   covered by the mesh's bounding sphere, dropping a level each
+ *   time this halves below GC::lodFullDetailSize.
+ * The owning Renderable must bind its VAO before draw().
+ */
+class LODChain
+{
+public:
+	LODChain();
+	~LODChain();
+
+	/* levels[0] is the full detail mesh. */
+	void init(
+		const std::vector<std::vector<GLuint>>& levels,
+		const std::vector<glm::vec4>& verts);
+
+	int select(const glm::mat4& modelToWorld, Camera* camera) const;
+	/* The finest level selected for any of the instances. */
+	int select(const glm::mat4& modelToWorld,
+		const std::vector<glm::mat4>& instances, Camera* camera) const;
+	void draw(int level) const;
+	void drawInstanced(int level, GLsizei nInstances) const;
+
+	int nLevels() const {return static_cast<int>(counts.size());};
+	size_t nElems(int level) const {return counts[level];};
+	const BoundingVolume& getBounds() const {return bounds;};
+private:
+	GLuint e_vbo;
+	GLenum elemType;
+	std::vector<size_t> offsets;
+	std::vector<size_t> counts;
+
+	BoundingVolume bounds; //In model space.
+};
+
+#endif
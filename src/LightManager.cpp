@@ -13,6 +13,7 @@ PhongLightManager::PhongLightManager()
 		block.lightAttenuation[i] = 0.0f;
 	}
 	nLights = 0;
+	blockChanged = false;
 
 	glGenBuffers(1, &block_ubo);
 	glBindBufferRange(GL_UNIFORM_BUFFER, Shader::getUBlockBindingIndex("phongBlock"),
@@ -51,8 +52,7 @@ PhongLight* PhongLightManager::update(PhongLight* l)
 	block.lightDiffuse[l->index]     = l->getDiffuse();
 	block.lightSpecular[l->index]    = l->getSpecular();
 	block.lightAttenuation[l->index] = l->getAttenuation();
-	++nLights;
-	updateBlock();
+	blockChanged = true;
 	return l;
 }
 
@@ -79,6 +79,12 @@ void PhongLightManager::updateBlock()
 	glBindBuffer(GL_UNIFORM_BUFFER, block_ubo);
 	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &(block));
 	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	blockChanged = false;
+}
+
+void PhongLightManager::flush()
+{
+	if(blockChanged) updateBlock();
 }
 
 SHLightManager::SHLightManager()
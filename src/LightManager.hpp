@@ -4,6 +4,7 @@
 #include <GL/glew.h>
 #include <array>
 #include <set>
+#include <atomic>
 
 #include "Light.hpp"
 #include "GC.hpp"
@@ -39,11 +40,15 @@ public:
 	PhongLight* update(PhongLight* l);
 	PhongLight* remove(PhongLight* l);
 	void updateBlock();
+	/* update() may be called from Renderable::update(), off the GL
+	 * thread, so only marks the block for upload by flush(). */
+	void flush();
 private:
 	std::array<PhongLight*, GC::maxPhongLights> lights;
 	phongBlock block;
 	GLuint block_ubo;
 	int nLights;
+	std::atomic<bool> blockChanged;
 };
 
 class SHLightManager
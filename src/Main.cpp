@@ -10,6 +10,11 @@
 #include <glm.hpp>
 #include <GL/glut.h>
 
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
 /* This file will contain the construction and rendering of the scene
  * I am working on right now. 
  */
@@ -20,6 +25,12 @@ void reshape (int, int);
 void keyboard(unsigned char, int, int);
 
 void addSHArray(Scene* scene, glm::vec3 pos, int nBands, float scale, float spacing);
+std::vector<glm::mat4> propTransforms();
+void addProps(Scene* scene, Texture* tex, LightShader* shader);
+void toggleProps();
+void addPackingBench(Scene* scene, Texture* tex, LightShader* shader);
+void togglePacking();
+void readTimerQueries();
 
 const int nSwirls = 400;
 const int nSparks = 5;
@@ -38,9 +49,48 @@ int deTime;
 
 const float delta = 0.4f;
 
+/* Prop benchmark: run with -p to draw nProps copies of one mesh,
+ * either as separate Meshes (sharing geometry) or as one instanced
+ * Mesh. Every 100 frames the mean render and frame times and the
+ * render queue stats are printed, and it switches to the other way
+ * of drawing them. Press 'i' to switch early.
+ */
+const int nProps = 400;
+bool propsBench = false;
+bool propsInstanced = true;
+std::vector<Mesh*> props;
+Mesh* propBatch = nullptr;
+
+/* Vertex packing benchmark: run with -v to draw nProps instances of
+ * one mesh, from a packed and an unpacked copy of its vertex buffer
+ * in turn, with rasterisation off so the draw is vertex bound. Every
+ * 100 frames the mean GPU time of the draw is printed, and it
+ * switches to the other buffer, as pressing 'i' does.
+ */
+bool packingBench = false;
+bool benchPacked = true;
+Mesh* packedMesh = nullptr;
+Mesh* unpackedMesh = nullptr;
+
+/* Render GPU times are read back a few frames late from a ring of
+ * GL_TIME_ELAPSED queries, so reading them does not stall the CPU. */
+const int nTimerQueries = 3;
+GLuint timerQueries[nTimerQueries] = {0};
+int timerFrame = 0; //Frames timed so far.
+int readFrame = 0; //First frame whose time has not been read back.
+int firstBenchFrame = 0; //Times from earlier frames are discarded.
+int nGPUFrames = 0;
+
+int nFrames = 0;
+float renderTime = 0.0f;
+float gpuTime = 0.0f;
+float frameTime = 0.0f;
+
 int main(int argc, char** argv)
 {
 	glutInit(&argc, argv);
+	propsBench = argc > 1 && strcmp(argv[1], "-p") == 0;
+	packingBench = argc > 1 && strcmp(argv[1], "-v") == 0;
 	eTime = glutGet(GLUT_ELAPSED_TIME);
     glutInitDisplayMode(GLUT_DOUBLE);
     glutInitWindowSize(500, 500);
@@ -86,7 +136,15 @@ int init()
 
 	//Texture* slateTex = new Texture("alphabet.png");
 	
-	LightShader* lightShader = new LightShader(false, "Mesh");
+	LightShader* lightShader = new LightShader(false, "BlinnPhong");
+
+	if(propsBench || packingBench)
+	{
+		Texture* propTex = new Texture("white.png");
+		if(propsBench) addProps(scene, propTex, lightShader);
+		else addPackingBench(scene, propTex, lightShader);
+		glGenQueries(nTimerQueries, timerQueries);
+	}
 
 	//Mesh* bunny = new Mesh("rabbit.obj", slateTex, slateTex, slateTex, 1.0f, lightShader);
 	//scene->add(bunny);
@@ -101,7 +159,8 @@ int init()
 
 	SHShader* shShader = new SHShader(false, "diffPRT");
 
-	PRTMesh::bake(INTERREFLECTED, "torii.obj", "torii.obj", "greenWhite.png", 40, 5, 1);
+	if(!propsBench && !packingBench)
+		PRTMesh::bake(INTERREFLECTED, "torii.obj", "torii.obj", "greenWhite.png", 40, 5, 1);
 	//PRTMesh* teapot = new PRTMesh("torii.obj.prts5", shShader);
 	//scene->add(teapot);
 
@@ -142,7 +201,53 @@ void display()
 	rotation = glm::rotate(glm::mat4(1.0), phi, glm::vec3(1.0, 0.0, 0.0));
 	rotation = glm::rotate(rotation, theta, glm::vec3(0.0, 1.0, 0.0));
 	light->rotateCoeffts(rotation);
+
+	if(timerQueries[0])
+	{
+		readTimerQueries();
+		if(timerFrame - readFrame == nTimerQueries) ++readFrame; //Still pending, drop it.
+		glBeginQuery(GL_TIME_ELAPSED, timerQueries[timerFrame % nTimerQueries]);
+	}
+	if(packingBench) glEnable(GL_RASTERIZER_DISCARD);
+	auto renderStart = std::chrono::high_resolution_clock::now();
 	scene->render();
+	renderTime += std::chrono::duration<float, std::milli>(
+		std::chrono::high_resolution_clock::now() - renderStart).count();
+	frameTime += deTime;
+	if(packingBench) glDisable(GL_RASTERIZER_DISCARD);
+	if(timerQueries[0])
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		++timerFrame;
+	}
+
+	if(propBatch && ++nFrames == 100)
+	{
+		std::cout << "> " << nProps << " props, " << (propsInstanced ? "instanced" : "separate")
+			<< ": " << renderTime / nFrames << "ms render (CPU), " 
+			<< gpuTime / std::max(nGPUFrames, 1) << "ms render (GPU, " 
+			<< nGPUFrames << " frames timed), "
+			<< frameTime / nFrames << "ms frame.\n";
+		const RenderStats& stats = scene->getRenderStats();
+		std::cout << "> " << stats.drawn << " drawn, " << stats.culled << " culled, " 
+			<< stats.shaderChanges << " shader changes (" 
+			<< stats.unsortedShaderChanges << " unsorted), "
+			<< stats.textureChanges << " texture set changes ("
+			<< stats.unsortedTextureChanges << " unsorted), "
+			<< stats.vaoChanges << " VAO changes, "
+			<< stats.programBinds << " glUseProgram calls.\n";
+		toggleProps();
+	}
+
+	if(packedMesh && ++nFrames == 100)
+	{
+		std::cout << "> " << nProps << " instances, " 
+			<< (benchPacked ? "packed" : "unpacked") << " vertices: " 
+			<< gpuTime / std::max(nGPUFrames, 1) << "ms GPU (" 
+			<< nGPUFrames << " frames timed).\n";
+		togglePacking();
+	}
+
 	glutSwapBuffers();
 	glutPostRedisplay();
 }
@@ -175,8 +280,115 @@ void keyboard(unsigned char key, int x, int y)
 		phi += 1.6f;
 		break;
 
+	case 'i':
+		toggleProps();
+		togglePacking();
+		break;
+
     case 27:
         exit(0);
         return;
     }
 }
+
+std::vector<glm::mat4> propTransforms()
+{
+	const int side = static_cast<int>(ceil(sqrt(static_cast<float>(nProps))));
+	const float spacing = 0.5f;
+
+	std::vector<glm::mat4> transforms;
+	for(int i = 0; i < nProps; ++i)
+	{
+		glm::vec3 pos(
+			((i % side) - side / 2) * spacing, -1.0f, 
+			((i / side) - side / 2) * spacing);
+		transforms.push_back(glm::translate(glm::mat4(1.0f), pos));
+	}
+
+	return transforms;
+}
+
+void addProps(Scene* scene, Texture* tex, LightShader* shader)
+{
+	std::vector<glm::mat4> transforms = propTransforms();
+	for(auto t = transforms.begin(); t != transforms.end(); ++t)
+	{
+		Mesh* prop = new Mesh("stanford.obj", tex, tex, tex, 1.0f, shader);
+		prop->moveTo(glm::vec3((*t)[3]));
+		props.push_back(prop);
+	}
+
+	propBatch = new Mesh("stanford.obj", tex, tex, tex, 1.0f, shader);
+	propBatch->setInstances(transforms);
+
+	propsInstanced = false;
+	toggleProps();
+}
+
+void toggleProps()
+{
+	if(!propBatch) return;
+
+	propsInstanced = !propsInstanced;
+	if(propsInstanced)
+	{
+		for(auto p = props.begin(); p != props.end(); ++p)
+			scene->remove(*p);
+		scene->add(propBatch);
+	}
+	else
+	{
+		scene->remove(propBatch);
+		for(auto p = props.begin(); p != props.end(); ++p)
+			scene->add(*p);
+	}
+
+	nFrames = nGPUFrames = 0;
+	firstBenchFrame = timerFrame;
+	renderTime = gpuTime = frameTime = 0.0f;
+}
+
+void addPackingBench(Scene* scene, Texture* tex, LightShader* shader)
+{
+	std::vector<glm::mat4> transforms = propTransforms();
+
+	packedMesh = new Mesh("stanford.obj", tex, tex, tex, 1.0f, shader, true);
+	packedMesh->setInstances(transforms);
+	unpackedMesh = new Mesh("stanford.obj", tex, tex, tex, 1.0f, shader, false);
+	unpackedMesh->setInstances(transforms);
+
+	benchPacked = false;
+	togglePacking();
+}
+
+void togglePacking()
+{
+	if(!packedMesh) return;
+
+	benchPacked = !benchPacked;
+	scene->remove(benchPacked ? unpackedMesh : packedMesh);
+	scene->add(benchPacked ? packedMesh : unpackedMesh);
+
+	nFrames = nGPUFrames = 0;
+	firstBenchFrame = timerFrame;
+	renderTime = gpuTime = frameTime = 0.0f;
+}
+
+void readTimerQueries()
+{
+	for(; readFrame < timerFrame; ++readFrame)
+	{
+		const GLuint query = timerQueries[readFrame % nTimerQueries];
+		GLint available = 0;
+		glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if(!available) return;
+
+		GLuint64 ns;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+		if(readFrame >= firstBenchFrame)
+		{
+			gpuTime += ns * 1e-6f;
+			++nGPUFrames;
+		}
+	}
+}
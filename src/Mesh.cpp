@@ -3,6 +3,10 @@
 #include "Scene.hpp"
 #include "Texture.hpp"
 #include "Intersect.hpp"
+#include "MeshCache.hpp"
+#include "MeshOptimiser.hpp"
+#include "MeshSimplifier.hpp"
+#include "GC.hpp"
 
 #include <float.h>
 #include <omp.h>
@@ -12,6 +16,8 @@
 
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <limits>
 
 bool fileExists(const std::string& filename)
 {
@@ -19,11 +25,38 @@ bool fileExists(const std::string& filename)
 	return file ? true : false;
 }
 
+GLenum bufferElements(const std::vector<GLuint>& elems)
+{
+	GLuint maxElem = elems.empty() ? 0 : 
+		*std::max_element(elems.begin(), elems.end());
+
+	if(maxElem <= std::numeric_limits<GLushort>::max())
+	{
+		std::vector<GLushort> shortElems(elems.begin(), elems.end());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * shortElems.size(),
+			shortElems.data(), GL_STATIC_DRAW);
+		return GL_UNSIGNED_SHORT;
+	}
+
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * elems.size(),
+		elems.data(), GL_STATIC_DRAW);
+	return GL_UNSIGNED_INT;
+}
+
 MeshData Mesh::loadSceneFile(
 	const std::string& filename)
 {
 	std::string fullPath = "../models/" + filename;
 
+	MeshData cached;
+	if(MeshCache::read(fullPath, cached))
+	{
+		std::cout << "Loaded " << filename << " from mesh cache: "
+			<< cached.v.size() << " vertices, "
+			<< cached.e.size() / 3 << " triangles.\n";
+		return cached;
+	}
+
 	Assimp::Importer importer;
 
 	const aiScene* scene = importer.ReadFile(fullPath,
@@ -83,9 +116,9 @@ MeshData Mesh::loadSceneFile(
 		for(int j = 0; j < (int) mesh->mNumFaces; ++j)
 		{
 			//Element indices.
-			d.e.push_back((GLushort) mesh->mFaces[j].mIndices[0]);
-			d.e.push_back((GLushort) mesh->mFaces[j].mIndices[1]);
-			d.e.push_back((GLushort) mesh->mFaces[j].mIndices[2]);
+			d.e.push_back(mesh->mFaces[j].mIndices[0]);
+			d.e.push_back(mesh->mFaces[j].mIndices[1]);
+			d.e.push_back(mesh->mFaces[j].mIndices[2]);
 		}
 
 		data.push_back(d);
@@ -95,6 +128,11 @@ MeshData Mesh::loadSceneFile(
 
 	std::cout << "All meshes loaded from " + fullPath + ".\n";
 
+	MeshOptimiser::optimise(mesh);
+	buildLODs(mesh);
+
+	MeshCache::write(fullPath, mesh);
+
 	return mesh;
 }
 
@@ -104,7 +142,7 @@ MeshData Mesh::combineData(const std::vector<MeshData>& data)
 
 	for(auto d = data.begin(); d != data.end(); ++d)
 	{
-		GLushort elemBase = static_cast<GLushort>(comb.e.size());
+		GLuint elemBase = static_cast<GLuint>(comb.v.size());
 
 		for(auto v = d->v.begin(); v != d->v.end(); ++v)
 			comb.v.push_back(*v);
@@ -119,86 +157,175 @@ MeshData Mesh::combineData(const std::vector<MeshData>& data)
 	return comb;
 }
 
+void Mesh::buildLODs(MeshData& data)
+{
+	std::vector<std::vector<GLuint>> chain = 
+		MeshSimplifier::buildLODChain(data, GC::nLODs, GC::lodTriRatio);
+
+	data.lods.assign(chain.begin() + 1, chain.end());
+	for(auto l = data.lods.begin(); l != data.lods.end(); ++l)
+		MeshOptimiser::optimiseVertexCache(*l, data.v.size());
+}
+
 Mesh::Mesh(		
 	const std::string& meshFilename,
 	Texture* ambTex,
 	Texture* diffTex,
 	Texture* specTex,
 	float exponent,
-	LightShader* shader)
-	:Renderable(false), shader(shader),
+	LightShader* shader,
+	bool packVertices)
+	:Renderable(false), shader(shader), geometry(nullptr),
 	ambTex(ambTex), diffTex(diffTex),
-	specTex(specTex), specExp(exponent)
+	specTex(specTex), specExp(exponent),
+	vao(0), v_attrib(0), n_attrib(0), t_attrib(0), inst_attrib(-1)
 {
-	MeshData data;
-	try
-	{
-		 data = loadSceneFile(meshFilename);
-	} 
-	catch(const MeshFileException& e)
+	const std::string key = 
+		(packVertices ? "Mesh packed " : "Mesh ") + meshFilename;
+	geometry = MeshGeometry::find(key);
+
+	if(!geometry)
 	{
-		std::cout << e.msg;
-		return;
+		MeshData data;
+		try
+		{
+			 data = loadSceneFile(meshFilename);
+		} 
+		catch(const MeshFileException& e)
+		{
+			std::cout << e.msg;
+			return;
+		}
+		geometry = MeshGeometry::share(key, createGeometry(data, packVertices));
 	}
-	init(data);
+
+	init();
 }
 
-void Mesh::init(const MeshData& data)
+MeshGeometry* Mesh::createGeometry(const MeshData& data, bool packVertices)
 {
-	numElems = data.e.size();
+	MeshGeometry* geom = new MeshGeometry();
+	geom->packed = packVertices;
 
-	std::vector<MeshVertex> vertBuffer;
-	for(unsigned i = 0; i < data.v.size(); ++i)
+	glGenBuffers(1, &geom->v_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, geom->v_vbo);
+
+	if(packVertices)
 	{
-		MeshVertex vert;
-		vert.v = data.v[i];
-		vert.n = data.n[i];
-		vert.t = data.t[i];
-		vertBuffer.push_back(vert);
+		geom->posBounds = VertexPacking::bounds(data.v);
+
+		std::vector<PackedMeshVertex> vertBuffer(data.v.size());
+		for(unsigned i = 0; i < data.v.size(); ++i)
+		{
+			VertexPacking::packPosition(data.v[i], geom->posBounds, vertBuffer[i].v);
+			VertexPacking::packNormal(data.n[i], vertBuffer[i].n);
+			VertexPacking::packTexCoord(data.t[i], vertBuffer[i].t);
+		}
+
+		glBufferData(GL_ARRAY_BUFFER, sizeof(PackedMeshVertex) * vertBuffer.size(),
+			vertBuffer.data(), GL_STATIC_DRAW);
+		VertexPacking::reportSaving("Mesh", data.v.size(), 
+			sizeof(PackedMeshVertex), sizeof(MeshVertex));
 	}
+	else
+	{
+		std::vector<MeshVertex> vertBuffer;
+		for(unsigned i = 0; i < data.v.size(); ++i)
+		{
+			MeshVertex vert;
+			vert.v = data.v[i];
+			vert.n = data.n[i];
+			vert.t = data.t[i];
+			vertBuffer.push_back(vert);
+		}
+
+		glBufferData(GL_ARRAY_BUFFER, sizeof(MeshVertex) * vertBuffer.size(),
+			vertBuffer.data(), GL_STATIC_DRAW);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	std::vector<std::vector<GLuint>> levels(1, data.e);
+	levels.insert(levels.end(), data.lods.begin(), data.lods.end());
+	geom->lods.init(levels, data.v);
+
+	return geom;
+}
 
+void Mesh::init()
+{
 	shader->setAmbTexUnit(ambTex->getTexUnit());
 	shader->setDiffTexUnit(diffTex->getTexUnit());
 	shader->setSpecTexUnit(specTex->getTexUnit());
 	shader->setSpecExp(specExp);
 
-	glGenBuffers(1, &v_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, v_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(MeshVertex) * vertBuffer.size(),
-		vertBuffer.data(), GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glGenBuffers(1, &e_vbo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, e_vbo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * data.e.size(),
-		data.e.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
 	v_attrib = shader->getAttribLoc("vPosition");
 	n_attrib = shader->getAttribLoc("vNorm");
 	t_attrib = shader->getAttribLoc("vTexCoord");
+	inst_attrib = shader->findAttribLoc("vInstance");
 
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao);
 
-	glBindBuffer(GL_ARRAY_BUFFER, v_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, geometry->v_vbo);
 	glEnableVertexAttribArray(v_attrib);
 	glEnableVertexAttribArray(n_attrib);
 	glEnableVertexAttribArray(t_attrib);
-	glVertexAttribPointer(v_attrib, 4, GL_FLOAT, GL_FALSE, sizeof(MeshVertex),
-		reinterpret_cast<GLvoid*>(offsetof(MeshVertex, v)));
-	glVertexAttribPointer(n_attrib, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), 
-		reinterpret_cast<GLvoid*>(offsetof(MeshVertex, n)));
-	glVertexAttribPointer(t_attrib, 2, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), 
-		reinterpret_cast<GLvoid*>(offsetof(MeshVertex, t)));
+	if(geometry->packed)
+	{
+		glVertexAttribPointer(v_attrib, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedMeshVertex),
+			reinterpret_cast<GLvoid*>(offsetof(PackedMeshVertex, v)));
+		glVertexAttribPointer(n_attrib, 2, GL_SHORT, GL_TRUE, sizeof(PackedMeshVertex), 
+			reinterpret_cast<GLvoid*>(offsetof(PackedMeshVertex, n)));
+		glVertexAttribPointer(t_attrib, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedMeshVertex), 
+			reinterpret_cast<GLvoid*>(offsetof(PackedMeshVertex, t)));
+	}
+	else
+	{
+		glVertexAttribPointer(v_attrib, 4, GL_FLOAT, GL_FALSE, sizeof(MeshVertex),
+			reinterpret_cast<GLvoid*>(offsetof(MeshVertex, v)));
+		glVertexAttribPointer(n_attrib, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), 
+			reinterpret_cast<GLvoid*>(offsetof(MeshVertex, n)));
+		glVertexAttribPointer(t_attrib, 2, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), 
+			reinterpret_cast<GLvoid*>(offsetof(MeshVertex, t)));
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if(inst_attrib != -1) instances.attach(inst_attrib);
 
 	glBindVertexArray(0);
 }
 
+void Mesh::setInstances(const std::vector<glm::mat4>& transforms)
+{
+	if(inst_attrib == -1 && !transforms.empty())
+	{
+		std::cout << "Shader " << shader->filename << " does not support instancing.\n";
+		return;
+	}
+	instances.set(transforms);
+}
+
+bool Mesh::getWorldBounds(BoundingVolume& bounds)
+{
+	if(!geometry) return false;
+
+	if(instances.size() > 0)
+		bounds = instances.bounds(geometry->lods.getBounds()).transformed(modelToWorld);
+	else
+		bounds = geometry->lods.getBounds().transformed(modelToWorld);
+
+	return true;
+}
+
 void Mesh::render()
 {
-	if(!scene) return;
+	if(!scene || !geometry) return;
 	
 	shader->setModelToWorld(modelToWorld);
+	shader->setPackedVerts(geometry->packed, 
+		geometry->posBounds.offset, geometry->posBounds.scale);
+	shader->setInstanced(instances.size() > 0);
 
 	shader->setAmbTexUnit(ambTex->getTexUnit());
 	shader->setDiffTexUnit(diffTex->getTexUnit());
@@ -208,12 +335,12 @@ void Mesh::render()
 	shader->use();
 
 	glBindVertexArray(vao);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, e_vbo);
 
-	glDrawElements(GL_TRIANGLES, (GLsizei) numElems, GL_UNSIGNED_SHORT, 0);
+	if(instances.size() > 0)
+		instances.draw(geometry->lods, modelToWorld, scene->camera);
+	else
+		geometry->lods.draw(geometry->lods.select(modelToWorld, scene->camera));
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
-
-	glUseProgram(0);
 }
@@ -3,6 +3,9 @@
 
 #include "Renderable.hpp"
 #include "Shader.hpp"
+#include "MeshGeometry.hpp"
+#include "InstanceBuffer.hpp"
+#include "GC.hpp"
 
 #include <vector>
 #include <string>
@@ -12,6 +15,12 @@
 
 bool fileExists(const std::string& filename);
 
+/* Fills the bound GL_ELEMENT_ARRAY_BUFFER with elems, using 16-bit
+ * indices if every index fits and 32-bit otherwise. Returns the
+ * index type to pass to glDrawElements.
+ */
+GLenum bufferElements(const std::vector<GLuint>& elems);
+
 class MeshFileException
 {
 public:
@@ -24,7 +33,8 @@ struct MeshData
 	std::vector<glm::vec4> v;
 	std::vector<glm::vec3> n;
 	std::vector<glm::vec2> t;
-	std::vector<GLushort > e;
+	std::vector<GLuint   > e;
+	std::vector<std::vector<GLuint>> lods; //Coarser element lists for e, if any.
 };
 
 class Texture;
@@ -36,6 +46,13 @@ struct MeshVertex
 	glm::vec2 t; // Tex coord
 };
 
+struct PackedMeshVertex
+{
+	GLushort v[4]; // Quantised position
+	GLshort  n[2]; // Octahedral norm
+	GLhalf   t[2]; // Tex coord
+};
+
 /* Mesh
  * A Renderable object containing a mesh, loaded from
  * a 3D model file and illuminated using Blinn-Phong 
@@ -43,6 +60,10 @@ struct MeshVertex
  * Has a rudimentary tex coord generation method, but it
  * is preferable to input meshes with their own texture
  * coordinates.
+ * Meshes loaded from the same file share their geometry, and
+ * one Mesh can draw many copies of itself via setInstances().
+ * Vertices are quantised (see VertexPacking) if packVertices
+ * is set. Packed and unpacked geometry are shared separately.
  */
 class Mesh : public Renderable
 {
@@ -53,21 +74,41 @@ public:
 		Texture* diffTex,
 		Texture* specTex,
 		float exponent,
-		LightShader* shader);
+		LightShader* shader,
+		bool packVertices = GC::packVertices);
 
 	void render();
 	void update(int dTime) {};
 	Shader* getShader() {return shader;};
-
+	GLuint getVAO() {return vao;};
+	bool getWorldBounds(BoundingVolume& bounds);
+	const void* getTextureSet() {return diffTex;};
+
+	/* Draws one copy of the mesh per transform, each applied
+	 * before modelToWorld, in a single instanced draw call.
+	 * An empty list returns to drawing the mesh once.
+	 */
+	void setInstances(const std::vector<glm::mat4>& transforms);
+
+	/* Loads ../models/filename, using its MeshCache file if it
+	 * is up to date and otherwise importing with Assimp,
+	 * optimising the result with MeshOptimiser, building its
+	 * LODs and writing a new cache file.
+	 */
 	static MeshData loadSceneFile(
 		const std::string& filename);
 
 	static MeshData combineData(const std::vector<MeshData>& data);
+
+	/* Fills data.lods with GC::nLODs - 1 simplified element lists. */
+	static void buildLODs(MeshData& data);
 private:
-	void init(const MeshData& data);
+	static MeshGeometry* createGeometry(const MeshData& data, bool packVertices);
+	void init();
 
 	LightShader* shader;
-	size_t numElems;
+	MeshGeometry* geometry;
+	InstanceBuffer instances;
 
 	Texture* ambTex;
 	Texture* diffTex;
@@ -75,11 +116,10 @@ private:
 	float specExp;
 
 	GLuint vao;
-	GLuint v_vbo;
-	GLuint e_vbo;
 	GLuint v_attrib;
 	GLuint n_attrib;
 	GLuint t_attrib;
+	GLint inst_attrib;
 };
 
 #endif
@@ -0,0 +1,276 @@
+#include "MeshCache.hpp"
+
+#include "GC.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const char CACHE_MAGIC[8] = {'F','F','M','E','S','H','\0','\0'};
+	const uint32_t CACHE_VERSION = 5;
+
+	struct CacheHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t indexSize;
+		uint64_t sourceSize;
+		int64_t sourceMTime;
+		uint32_t nVerts;
+		uint32_t nElems;
+		uint32_t nLODs;
+		/* Settings the mesh was processed with. */
+		uint32_t lodSetting;
+		float lodTriRatio;
+		uint32_t vertexCacheSize;
+		uint32_t optimiseOverdraw;
+		uint32_t pad;
+	};
+
+	void setSettings(CacheHeader& header)
+	{
+		header.lodSetting = static_cast<uint32_t>(GC::nLODs);
+		header.lodTriRatio = GC::lodTriRatio;
+		header.vertexCacheSize = static_cast<uint32_t>(GC::vertexCacheSize);
+		header.optimiseOverdraw = GC::optimiseOverdraw ? 1 : 0;
+	}
+
+	/* A cache built with other settings is stale, as a changed source is. */
+	bool settingsMatch(const CacheHeader& header)
+	{
+		CacheHeader current;
+		setSettings(current);
+		return header.lodSetting == current.lodSetting &&
+			header.lodTriRatio == current.lodTriRatio &&
+			header.vertexCacheSize == current.vertexCacheSize &&
+			header.optimiseOverdraw == current.optimiseOverdraw;
+	}
+
+	bool sourceStats(const std::string& filename, uint64_t& size, int64_t& mTime)
+	{
+		struct stat s;
+		if(stat(filename.c_str(), &s) != 0) return false;
+		size = static_cast<uint64_t>(s.st_size);
+		mTime = static_cast<int64_t>(s.st_mtime);
+		return true;
+	}
+
+	/* MappedFile
+	 * Read-only memory mapping of a whole file.
+	 */
+	class MappedFile
+	{
+	public:
+		MappedFile(const std::string& filename);
+		~MappedFile();
+		const char* data() const {return ptr;};
+		size_t size() const {return length;};
+	private:
+		const char* ptr;
+		size_t length;
+#ifdef _WIN32
+		HANDLE file;
+		HANDLE mapping;
+#endif
+	};
+
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::string& filename)
+		:ptr(nullptr), length(0), mapping(NULL)
+	{
+		file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+			NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if(file == INVALID_HANDLE_VALUE) return;
+
+		LARGE_INTEGER fileSize;
+		if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) return;
+
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if(!mapping) return;
+
+		ptr = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if(ptr) length = static_cast<size_t>(fileSize.QuadPart);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if(ptr) UnmapViewOfFile(ptr);
+		if(mapping) CloseHandle(mapping);
+		if(file != INVALID_HANDLE_VALUE) CloseHandle(file);
+	}
+#else
+	MappedFile::MappedFile(const std::string& filename)
+		:ptr(nullptr), length(0)
+	{
+		int fd = open(filename.c_str(), O_RDONLY);
+		if(fd < 0) return;
+
+		struct stat s;
+		if(fstat(fd, &s) == 0 && s.st_size > 0)
+		{
+			void* p = mmap(nullptr, s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(p != MAP_FAILED)
+			{
+				ptr = static_cast<const char*>(p);
+				length = static_cast<size_t>(s.st_size);
+			}
+		}
+		close(fd);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if(ptr) munmap(const_cast<char*>(ptr), length);
+	}
+#endif
+
+	template <typename T>
+	void readArray(const char*& p, std::vector<T>& dst, size_t n)
+	{
+		const T* src = reinterpret_cast<const T*>(p);
+		dst.assign(src, src + n);
+		p += sizeof(T) * n;
+	}
+
+	template <typename T>
+	void writeArray(std::ofstream& file, const std::vector<T>& src)
+	{
+		file.write(reinterpret_cast<const char*>(src.data()), sizeof(T) * src.size());
+	}
+
+	template <typename T>
+	void readElems(const char*& p, std::vector<GLuint>& dst, size_t n)
+	{
+		std::vector<T> elems;
+		readArray(p, elems, n);
+		dst.assign(elems.begin(), elems.end());
+	}
+
+	void writeElems(std::ofstream& file, const std::vector<GLuint>& src, bool shortElems)
+	{
+		if(shortElems) writeArray(file, std::vector<GLushort>(src.begin(), src.end()));
+		else writeArray(file, src);
+	}
+}
+
+std::string MeshCache::cacheFilename(const std::string& sourceFilename)
+{
+	return sourceFilename + ".mcache";
+}
+
+bool MeshCache::read(const std::string& sourceFilename, MeshData& data)
+{
+	uint64_t sourceSize;
+	int64_t sourceMTime;
+	if(!sourceStats(sourceFilename, sourceSize, sourceMTime)) return false;
+
+	MappedFile file(cacheFilename(sourceFilename));
+	if(!file.data() || file.size() < sizeof(CacheHeader)) return false;
+
+	CacheHeader header;
+	memcpy(&header, file.data(), sizeof(CacheHeader));
+
+	if(memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+		header.version != CACHE_VERSION ||
+		(header.indexSize != sizeof(GLushort) && header.indexSize != sizeof(GLuint)) ||
+		header.sourceSize != sourceSize ||
+		header.sourceMTime != sourceMTime ||
+		!settingsMatch(header))
+		return false;
+
+	/* Each LOD is stored as its element count followed by its elements. */
+	const char* end = file.data() + file.size();
+	const char* p = file.data() + sizeof(CacheHeader);
+	size_t size = 
+		header.nVerts * (sizeof(glm::vec4) + sizeof(glm::vec3) + sizeof(glm::vec2)) +
+		header.nElems * header.indexSize;
+
+	for(uint32_t l = 0; l <= header.nLODs && p + size <= end; ++l)
+	{
+		p += size;
+		uint32_t nLODElems = 0;
+		if(l < header.nLODs && p + sizeof(uint32_t) <= end)
+			memcpy(&nLODElems, p, sizeof(uint32_t));
+		size = sizeof(uint32_t) + nLODElems * header.indexSize;
+	}
+	if(p != end)
+	{
+		std::cout << "Mesh cache " << cacheFilename(sourceFilename)
+			<< " is invalid, ignoring.\n";
+		return false;
+	}
+
+	p = file.data() + sizeof(CacheHeader);
+	readArray(p, data.v, header.nVerts);
+	readArray(p, data.n, header.nVerts);
+	readArray(p, data.t, header.nVerts);
+
+	data.lods.resize(header.nLODs);
+	for(uint32_t l = 0; l <= header.nLODs; ++l)
+	{
+		std::vector<GLuint>& elems = l == 0 ? data.e : data.lods[l-1];
+		uint32_t nElems = header.nElems;
+		if(l > 0)
+		{
+			memcpy(&nElems, p, sizeof(uint32_t));
+			p += sizeof(uint32_t);
+		}
+
+		if(header.indexSize == sizeof(GLushort)) readElems<GLushort>(p, elems, nElems);
+		else readElems<GLuint>(p, elems, nElems);
+	}
+
+	return true;
+}
+
+void MeshCache::write(const std::string& sourceFilename, const MeshData& data)
+{
+	CacheHeader header;
+	memset(&header, 0, sizeof(CacheHeader));
+	memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.version = CACHE_VERSION;
+	bool shortElems = data.v.size() <= std::numeric_limits<GLushort>::max() + 1u;
+	header.indexSize = shortElems ? sizeof(GLushort) : sizeof(GLuint);
+	if(!sourceStats(sourceFilename, header.sourceSize, header.sourceMTime)) return;
+	header.nVerts = static_cast<uint32_t>(data.v.size());
+	header.nElems = static_cast<uint32_t>(data.e.size());
+	header.nLODs = static_cast<uint32_t>(data.lods.size());
+	setSettings(header);
+
+	std::ofstream file(cacheFilename(sourceFilename), std::ios::binary);
+	if(!file)
+	{
+		std::cout << "Could not write mesh cache " << cacheFilename(sourceFilename) << ".\n";
+		return;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+	writeArray(file, data.v);
+	writeArray(file, data.n);
+	writeArray(file, data.t);
+	writeElems(file, data.e, shortElems);
+	for(auto l = data.lods.begin(); l != data.lods.end(); ++l)
+	{
+		uint32_t nElems = static_cast<uint32_t>(l->size());
+		file.write(reinterpret_cast<const char*>(&nElems), sizeof(uint32_t));
+		writeElems(file, *l, shortElems);
+	}
+	file.close();
+}
@@ -0,0 +1,28 @@
+#ifndef MESHCACHE_HPP
+#define MESHCACHE_HPP
+
+#include "Mesh.hpp"
+
+#include <string>
+
+/* MeshCache
+ * Binary cache of processed meshes, stored next to the source file
+ *   as <filename>.mcache.
+ * Each cache file records the size and modification time of the
+ *   model file it was built from, and the GC settings it was processed
+ *   with (LODs and vertex cache optimisation), and is ignored if any
+ *   of these no longer match. Valid cache files are memory-mapped and copied straight
+ *   into a MeshData, so Assimp is not needed to load them.
+ * Indices are stored as 16-bit where every index fits, otherwise
+ *   as 32-bit.
+ */
+namespace MeshCache
+{
+	std::string cacheFilename(const std::string& sourceFilename);
+
+	/* Returns true and fills data if a valid cache exists for the source. */
+	bool read(const std::string& sourceFilename, MeshData& data);
+	void write(const std::string& sourceFilename, const MeshData& data);
+}
+
+#endif
@@ -0,0 +1,33 @@
+#include "MeshGeometry.hpp"
+
+MeshGeometry::MeshGeometry()
+	:v_vbo(0), packed(false)
+{
+	posBounds.offset = glm::vec3(0.0f);
+	posBounds.scale = glm::vec3(1.0f);
+}
+
+MeshGeometry::~MeshGeometry()
+{
+	if(v_vbo) glDeleteBuffers(1, &v_vbo);
+}
+
+MeshGeometry* MeshGeometry::find(const std::string& key)
+{
+	auto g = registry().find(key);
+	return g == registry().end() ? nullptr : g->second;
+}
+
+MeshGeometry* MeshGeometry::share(const std::string& key, MeshGeometry* geometry)
+{
+	MeshGeometry*& entry = registry()[key];
+	if(entry && entry != geometry) delete geometry;
+	else entry = geometry;
+	return entry;
+}
+
+std::map<std::string, MeshGeometry*>& MeshGeometry::registry()
+{
+	static std::map<std::string, MeshGeometry*> geometry;
+	return geometry;
+}
@@ -0,0 +1,45 @@
+#ifndef MESHGEOMETRY_HPP
+#define MESHGEOMETRY_HPP
+
+#include "LODChain.hpp"
+#include "VertexPacking.hpp"
+
+#include <GL/glew.h>
+
+#include <string>
+#include <map>
+
+/* MeshGeometry
+ * The GL resources loaded from one mesh file: its vertex buffer,
+ *   LODs and packing bounds, if its vertices are packed.
+ * Geometry is shared between every Mesh, AOMesh and PRTMesh made
+ *   from the same file, so each file is only read and uploaded
+ *   once. Classes needing more per-file data (e.g. AOMesh's
+ *   textures) derive from MeshGeometry to hold it.
+ * Shared geometry is owned by MeshGeometry, and lives until the
+ *   program exits.
+ */
+class MeshGeometry
+{
+public:
+	MeshGeometry();
+	virtual ~MeshGeometry();
+
+	/* find() returns nullptr if nothing is shared under key. */
+	static MeshGeometry* find(const std::string& key);
+	/* share() takes ownership of geometry and returns the geometry
+	 * shared under key (which is geometry unless key was taken). */
+	static MeshGeometry* share(const std::string& key, MeshGeometry* geometry);
+
+	GLuint v_vbo;
+	LODChain lods;
+	VertexPacking::Bounds posBounds;
+	bool packed;
+private:
+	MeshGeometry(const MeshGeometry&);
+	MeshGeometry& operator=(const MeshGeometry&);
+
+	static std::map<std::string, MeshGeometry*>& registry();
+};
+
+#endif
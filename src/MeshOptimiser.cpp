@@ -0,0 +1,278 @@
+#include "MeshOptimiser.hpp"
+
+#include "GC.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	/* Tuning values from Forsyth's "Linear-Speed Vertex Cache Optimisation". */
+	const float cacheDecayPower = 1.5f;
+	const float lastTriScore = 0.75f;
+	const float valenceBoostScale = 2.0f;
+	const float valenceBoostPower = 0.5f;
+
+	float vertexScore(int cachePos, int remainingTris)
+	{
+		if(remainingTris == 0) return -1.0f;
+
+		float score = 0.0f;
+
+		if(cachePos >= 0)
+		{
+			/* The three most recent verts are from the last triangle, and
+			 * are deliberately given a fixed lower score. */
+			if(cachePos < 3) score = lastTriScore;
+			else
+			{
+				float scaler = 1.0f / (GC::vertexCacheSize - 3);
+				score = pow(1.0f - (cachePos - 3) * scaler, cacheDecayPower);
+			}
+		}
+
+		/* Boost verts with few triangles left, to avoid leaving lone triangles. */
+		score += valenceBoostScale *
+			pow(static_cast<float>(remainingTris), -valenceBoostPower);
+
+		return score;
+	}
+}
+
+void MeshOptimiser::optimise(MeshData& data)
+{
+	float acmrBefore = acmr(data.e, data.v.size());
+
+	optimiseVertexCache(data.e, data.v.size());
+	if(GC::optimiseOverdraw) optimiseOverdraw(data.e, data);
+	optimiseVertexFetch(data);
+
+	std::cout << "> Vertex cache ACMR: " << acmrBefore
+		<< " before, " << acmr(data.e, data.v.size()) << " after optimisation.\n";
+}
+
+void MeshOptimiser::optimiseVertexCache(std::vector<GLuint>& elems, size_t nVerts)
+{
+	const int nTris = static_cast<int>(elems.size() / 3);
+	if(nTris == 0) return;
+
+	/* Build vertex-triangle adjacency, with the triangles of vert v
+	 * stored in adj[offset[v]] to adj[offset[v] + remaining[v]]. */
+	std::vector<int> remaining(nVerts, 0);
+	for(auto e = elems.begin(); e != elems.end(); ++e)
+		++remaining[*e];
+
+	std::vector<int> offset(nVerts + 1, 0);
+	for(size_t v = 0; v < nVerts; ++v)
+		offset[v + 1] = offset[v] + remaining[v];
+
+	std::vector<int> adj(elems.size());
+	std::vector<int> fill(offset.begin(), offset.end() - 1);
+	for(int t = 0; t < nTris; ++t)
+		for(int k = 0; k < 3; ++k)
+			adj[fill[elems[3*t + k]]++] = t;
+
+	std::vector<int> cachePos(nVerts, -1);
+	std::vector<float> vScore(nVerts);
+	for(size_t v = 0; v < nVerts; ++v)
+		vScore[v] = vertexScore(-1, remaining[v]);
+
+	std::vector<float> tScore(nTris);
+	std::vector<bool> emitted(nTris, false);
+	int best = 0;
+	for(int t = 0; t < nTris; ++t)
+	{
+		tScore[t] = vScore[elems[3*t]] + vScore[elems[3*t + 1]] + vScore[elems[3*t + 2]];
+		if(tScore[t] > tScore[best]) best = t;
+	}
+
+	std::vector<GLuint> out;
+	out.reserve(elems.size());
+	std::vector<GLuint> cache, newCache;
+	int cursor = 0;
+
+	while(static_cast<int>(out.size()) < 3 * nTris)
+	{
+		/* Nothing in the cache has triangles left, so start elsewhere. */
+		if(best < 0)
+		{
+			while(emitted[cursor]) ++cursor;
+			best = cursor;
+		}
+
+		emitted[best] = true;
+		newCache.clear();
+
+		for(int k = 0; k < 3; ++k)
+		{
+			GLuint v = elems[3*best + k];
+			out.push_back(v);
+			newCache.push_back(v);
+
+			/* Remove this triangle from v's remaining triangles. */
+			int* first = &adj[offset[v]];
+			int* last = first + remaining[v] - 1;
+			*std::find(first, last + 1, best) = *last;
+			--remaining[v];
+		}
+
+		for(auto c = cache.begin(); c != cache.end(); ++c)
+			if(std::find(newCache.begin(), newCache.begin() + 3, *c) == newCache.begin() + 3)
+				newCache.push_back(*c);
+
+		/* Update scores of all cached (and just evicted) verts. */
+		for(int i = 0; i < static_cast<int>(newCache.size()); ++i)
+		{
+			GLuint v = newCache[i];
+			cachePos[v] = i < GC::vertexCacheSize ? i : -1;
+			vScore[v] = vertexScore(cachePos[v], remaining[v]);
+		}
+
+		/* Rescore their triangles, choosing the best as the next to emit. */
+		best = -1;
+		float bestScore = -1.0f;
+		for(auto c = newCache.begin(); c != newCache.end(); ++c)
+			for(int a = offset[*c]; a < offset[*c] + remaining[*c]; ++a)
+			{
+				int t = adj[a];
+				tScore[t] = vScore[elems[3*t]] + vScore[elems[3*t + 1]] + vScore[elems[3*t + 2]];
+				if(tScore[t] > bestScore)
+				{
+					bestScore = tScore[t];
+					best = t;
+				}
+			}
+
+		if(static_cast<int>(newCache.size()) > GC::vertexCacheSize)
+			newCache.resize(GC::vertexCacheSize);
+		cache.swap(newCache);
+	}
+
+	elems.swap(out);
+}
+
+void MeshOptimiser::optimiseOverdraw(std::vector<GLuint>& elems, const MeshData& data)
+{
+	const size_t nTris = elems.size() / 3;
+	if(nTris == 0) return;
+
+	/* Split into clusters wherever the cache order restarts, i.e. at
+	 * triangles whose verts all miss the cache. */
+	std::vector<size_t> clusterStart;
+	std::vector<unsigned> cacheTime(data.v.size(), 0);
+	unsigned time = GC::vertexCacheSize + 1;
+
+	for(size_t t = 0; t < nTris; ++t)
+	{
+		int misses = 0;
+		for(int k = 0; k < 3; ++k)
+		{
+			GLuint v = elems[3*t + k];
+			if(time - cacheTime[v] > static_cast<unsigned>(GC::vertexCacheSize))
+			{
+				cacheTime[v] = time++;
+				++misses;
+			}
+		}
+		if(misses == 3 || t == 0) clusterStart.push_back(t);
+	}
+	clusterStart.push_back(nTris);
+
+	glm::vec3 meshCentroid(0.0f);
+	for(auto v = data.v.begin(); v != data.v.end(); ++v)
+		meshCentroid += glm::vec3(*v);
+	meshCentroid /= static_cast<float>(data.v.size());
+
+	/* Draw clusters facing away from the centre first, as they are the
+	 * most likely to occlude the others. */
+	const size_t nClusters = clusterStart.size() - 1;
+	std::vector<std::pair<float, size_t>> order(nClusters);
+
+	for(size_t c = 0; c < nClusters; ++c)
+	{
+		glm::vec3 centroid(0.0f), norm(0.0f);
+		float area = 0.0f;
+
+		for(size_t t = clusterStart[c]; t < clusterStart[c+1]; ++t)
+		{
+			glm::vec3 a(data.v[elems[3*t]]);
+			glm::vec3 b(data.v[elems[3*t + 1]]);
+			glm::vec3 d(data.v[elems[3*t + 2]]);
+			glm::vec3 n = glm::cross(b - a, d - a);
+			float triArea = glm::length(n);
+
+			norm += n;
+			centroid += triArea * (a + b + d) / 3.0f;
+			area += triArea;
+		}
+
+		float score = 0.0f;
+		if(area > EPS && glm::length(norm) > EPS)
+			score = glm::dot(centroid / area - meshCentroid, glm::normalize(norm));
+
+		order[c] = std::make_pair(-score, c);
+	}
+
+	std::stable_sort(order.begin(), order.end());
+
+	std::vector<GLuint> out;
+	out.reserve(elems.size());
+	for(auto o = order.begin(); o != order.end(); ++o)
+		out.insert(out.end(),
+			elems.begin() + 3 * clusterStart[o->second],
+			elems.begin() + 3 * clusterStart[o->second + 1]);
+
+	elems.swap(out);
+}
+
+void MeshOptimiser::optimiseVertexFetch(MeshData& data)
+{
+	const GLuint unused = static_cast<GLuint>(-1);
+	std::vector<GLuint> remap(data.v.size(), unused);
+	GLuint next = 0;
+
+	for(auto e = data.e.begin(); e != data.e.end(); ++e)
+	{
+		if(remap[*e] == unused) remap[*e] = next++;
+		*e = remap[*e];
+	}
+
+	/* Keep any unreferenced verts, at the end. */
+	for(auto r = remap.begin(); r != remap.end(); ++r)
+		if(*r == unused) *r = next++;
+
+	MeshData reordered;
+	reordered.v.resize(data.v.size());
+	reordered.n.resize(data.n.size());
+	reordered.t.resize(data.t.size());
+
+	for(size_t v = 0; v < remap.size(); ++v)
+	{
+		reordered.v[remap[v]] = data.v[v];
+		if(v < data.n.size()) reordered.n[remap[v]] = data.n[v];
+		if(v < data.t.size()) reordered.t[remap[v]] = data.t[v];
+	}
+
+	data.v.swap(reordered.v);
+	data.n.swap(reordered.n);
+	data.t.swap(reordered.t);
+}
+
+float MeshOptimiser::acmr(const std::vector<GLuint>& elems, size_t nVerts)
+{
+	if(elems.empty()) return 0.0f;
+
+	std::vector<unsigned> cacheTime(nVerts, 0);
+	unsigned time = GC::vertexCacheSize + 1;
+	size_t misses = 0;
+
+	for(auto e = elems.begin(); e != elems.end(); ++e)
+		if(time - cacheTime[*e] > static_cast<unsigned>(GC::vertexCacheSize))
+		{
+			cacheTime[*e] = time++;
+			++misses;
+		}
+
+	return static_cast<float>(misses) / (elems.size() / 3);
+}
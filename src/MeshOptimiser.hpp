@@ -0,0 +1,32 @@
+#ifndef MESHOPTIMISER_HPP
+#define MESHOPTIMISER_HPP
+
+#include "Mesh.hpp"
+
+#include <vector>
+
+/* MeshOptimiser
+ * Reorders mesh data for faster rendering without changing the
+ *   rendered result.
+ * optimiseVertexCache() reorders triangles for post-transform
+ *   vertex cache hits, using Forsyth's linear-speed algorithm.
+ * optimiseOverdraw() then reorders clusters of those triangles so
+ *   that outward-facing clusters are drawn first.
+ * optimiseVertexFetch() reorders vertices into the order they are
+ *   first used by the triangles, for memory locality.
+ * ACMR is the average number of vertex cache misses per triangle,
+ *   simulated for a FIFO cache of GC::vertexCacheSize entries.
+ */
+namespace MeshOptimiser
+{
+	/* Runs all enabled passes and reports ACMR before and after. */
+	void optimise(MeshData& data);
+
+	void optimiseVertexCache(std::vector<GLuint>& elems, size_t nVerts);
+	void optimiseOverdraw(std::vector<GLuint>& elems, const MeshData& data);
+	void optimiseVertexFetch(MeshData& data);
+
+	float acmr(const std::vector<GLuint>& elems, size_t nVerts);
+}
+
+#endif
@@ -0,0 +1,250 @@
+#include "MeshSimplifier.hpp"
+
+#include "GC.hpp"
+
+#include <algorithm>
+#include <queue>
+#include <iostream>
+
+namespace
+{
+	/* Symmetric 4x4 error quadric, stored as its upper triangle. */
+	struct Quadric
+	{
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+		Quadric()
+			:a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0) {};
+
+		/* Quadric of the plane ax + by + cz + d = 0, scaled by weight. */
+		Quadric(double a, double b, double c, double d, double weight)
+			:a2(weight*a*a), ab(weight*a*b), ac(weight*a*c), ad(weight*a*d),
+			b2(weight*b*b), bc(weight*b*c), bd(weight*b*d),
+			c2(weight*c*c), cd(weight*c*d), d2(weight*d*d) {};
+
+		Quadric& operator+=(const Quadric& q)
+		{
+			a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2;
+			bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2;
+			return *this;
+		}
+
+		double error(const glm::vec4& p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			return
+				a2*x*x + 2*ab*x*y + 2*ac*x*z + 2*ad*x +
+				b2*y*y + 2*bc*y*z + 2*bd*y +
+				c2*z*z + 2*cd*z + d2;
+		}
+	};
+
+	struct Collapse
+	{
+		double cost;
+		GLuint from;
+		GLuint to;
+		unsigned fromVersion;
+		unsigned toVersion;
+
+		bool operator>(const Collapse& c) const {return cost > c.cost;};
+	};
+
+	glm::vec3 triNorm(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+	{
+		return glm::cross(glm::vec3(b - a), glm::vec3(c - a));
+	}
+}
+
+std::vector<GLuint> MeshSimplifier::simplify(
+	const MeshData& data,
+	const std::vector<GLuint>& elems,
+	size_t targetTris)
+{
+	const size_t nVerts = data.v.size();
+	const size_t nTris = elems.size() / 3;
+
+	if(nTris <= targetTris) return elems;
+
+	std::vector<GLuint> tris(elems);
+	std::vector<bool> triAlive(nTris, true);
+	size_t nAlive = nTris;
+
+	/* Vertex-triangle adjacency (may include dead triangles). */
+	std::vector<std::vector<int>> vertTris(nVerts);
+	for(size_t t = 0; t < nTris; ++t)
+		for(int k = 0; k < 3; ++k)
+			vertTris[tris[3*t + k]].push_back(static_cast<int>(t));
+
+	/* Accumulate area-weighted plane quadrics at each vertex. */
+	std::vector<Quadric> quadrics(nVerts);
+	for(size_t t = 0; t < nTris; ++t)
+	{
+		const glm::vec4& a = data.v[tris[3*t]];
+		glm::vec3 n = triNorm(a, data.v[tris[3*t + 1]], data.v[tris[3*t + 2]]);
+		float area = glm::length(n);
+		if(area < EPS) continue;
+		n /= area;
+		Quadric q(n.x, n.y, n.z, -glm::dot(n, glm::vec3(a)), 0.5 * area);
+		for(int k = 0; k < 3; ++k)
+			quadrics[tris[3*t + k]] += q;
+	}
+
+	/* Lock vertices on border and non-manifold edges, i.e. those not
+	 * used by exactly two triangles. */
+	std::vector<std::pair<GLuint, GLuint>> edges;
+	edges.reserve(3 * nTris);
+	for(size_t t = 0; t < nTris; ++t)
+		for(int k = 0; k < 3; ++k)
+		{
+			GLuint u = tris[3*t + k], v = tris[3*t + (k+1)%3];
+			edges.push_back(std::make_pair(std::min(u, v), std::max(u, v)));
+		}
+	std::sort(edges.begin(), edges.end());
+
+	std::vector<bool> locked(nVerts, false);
+	for(size_t i = 0; i < edges.size(); )
+	{
+		size_t j = i;
+		while(j < edges.size() && edges[j] == edges[i]) ++j;
+		if(j - i != 2) locked[edges[i].first] = locked[edges[i].second] = true;
+		i = j;
+	}
+
+	std::vector<unsigned> version(nVerts, 0);
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+
+	auto pushCollapse = [&](GLuint from, GLuint to)
+	{
+		if(locked[from]) return;
+		Quadric q = quadrics[from];
+		q += quadrics[to];
+		Collapse c = {q.error(data.v[to]), from, to, version[from], version[to]};
+		heap.push(c);
+	};
+
+	for(size_t t = 0; t < nTris; ++t)
+		for(int k = 0; k < 3; ++k)
+		{
+			pushCollapse(tris[3*t + k], tris[3*t + (k+1)%3]);
+			pushCollapse(tris[3*t + (k+1)%3], tris[3*t + k]);
+		}
+
+	while(nAlive > targetTris && !heap.empty())
+	{
+		Collapse c = heap.top();
+		heap.pop();
+
+		if(c.fromVersion != version[c.from] || c.toVersion != version[c.to]) continue;
+
+		/* Reject the collapse if it would flip any remaining triangle. */
+		bool flips = false;
+		bool stillAdjacent = false;
+		for(auto t = vertTris[c.from].begin(); t != vertTris[c.from].end() && !flips; ++t)
+		{
+			if(!triAlive[*t]) continue;
+			GLuint* tri = &tris[3 * *t];
+			if(tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+			{
+				stillAdjacent = true;
+				continue;
+			}
+
+			glm::vec4 p[3];
+			for(int k = 0; k < 3; ++k)
+				p[k] = data.v[tri[k] == c.from ? c.to : tri[k]];
+			glm::vec3 before = triNorm(data.v[tri[0]], data.v[tri[1]], data.v[tri[2]]);
+			glm::vec3 after = triNorm(p[0], p[1], p[2]);
+			if(glm::dot(before, after) <= 0.0f) flips = true;
+		}
+		if(flips || !stillAdjacent) continue;
+
+		/* Move from's triangles onto to, killing those that degenerate. */
+		for(auto t = vertTris[c.from].begin(); t != vertTris[c.from].end(); ++t)
+		{
+			if(!triAlive[*t]) continue;
+			GLuint* tri = &tris[3 * *t];
+			if(tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+			{
+				triAlive[*t] = false;
+				--nAlive;
+				continue;
+			}
+			for(int k = 0; k < 3; ++k)
+				if(tri[k] == c.from) tri[k] = c.to;
+			vertTris[c.to].push_back(*t);
+		}
+		vertTris[c.from].clear();
+
+		quadrics[c.to] += quadrics[c.from];
+		++version[c.from];
+		++version[c.to];
+
+		/* Re-cost all edges around the merged vertex. */
+		for(auto t = vertTris[c.to].begin(); t != vertTris[c.to].end(); ++t)
+		{
+			if(!triAlive[*t]) continue;
+			for(int k = 0; k < 3; ++k)
+			{
+				GLuint w = tris[3 * *t + k];
+				if(w == c.to) continue;
+				pushCollapse(c.to, w);
+				pushCollapse(w, c.to);
+			}
+		}
+	}
+
+	std::vector<GLuint> simplified;
+	simplified.reserve(3 * nAlive);
+	for(size_t t = 0; t < nTris; ++t)
+		if(triAlive[t])
+			simplified.insert(simplified.end(), &tris[3*t], &tris[3*t] + 3);
+
+	return simplified;
+}
+
+std::vector<std::vector<GLuint>> MeshSimplifier::buildLODChain(
+	const MeshData& data,
+	int nLevels,
+	float ratio)
+{
+	std::vector<std::vector<GLuint>> chain(1, data.e);
+
+	for(int l = 1; l < nLevels; ++l)
+	{
+		const std::vector<GLuint>& prev = chain.back();
+		size_t target = static_cast<size_t>((prev.size() / 3) * ratio);
+		std::vector<GLuint> next = simplify(data, prev, target);
+
+		if(next.size() >= prev.size()) break;
+		chain.push_back(next);
+	}
+
+	std::cout << "> Built " << chain.size() << " LODs of";
+	for(auto l = chain.begin(); l != chain.end(); ++l)
+		std::cout << " " << l->size() / 3;
+	std::cout << " triangles.\n";
+
+	return chain;
+}
+
+MeshData MeshSimplifier::extract(const MeshData& data, const std::vector<GLuint>& elems)
+{
+	const GLuint unused = static_cast<GLuint>(-1);
+	std::vector<GLuint> remap(data.v.size(), unused);
+	MeshData out;
+
+	for(auto e = elems.begin(); e != elems.end(); ++e)
+	{
+		if(remap[*e] == unused)
+		{
+			remap[*e] = static_cast<GLuint>(out.v.size());
+			out.v.push_back(data.v[*e]);
+			out.n.push_back(data.n[*e]);
+			out.t.push_back(data.t[*e]);
+		}
+		out.e.push_back(remap[*e]);
+	}
+
+	return out;
+}
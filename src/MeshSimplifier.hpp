@@ -0,0 +1,41 @@
+#ifndef MESHSIMPLIFIER_HPP
+#define MESHSIMPLIFIER_HPP
+
+#include "Mesh.hpp"
+
+#include <vector>
+
+/* MeshSimplifier
+ * Quadric error metric mesh simplification (Garland & Heckbert).
+ * Edges are collapsed onto one of their existing vertices, so the
+ *   simplified elements index into the original vertex data, and
+ *   several levels of detail can share one vertex buffer.
+ * Vertices on mesh borders (including texture and normal seams,
+ *   where vertices are split) are never moved, and collapses which
+ *   would flip a triangle are rejected.
+ */
+namespace MeshSimplifier
+{
+	/* Simplifies the triangles in elems (indexing data.v) to at most
+	 * targetTris triangles, or as close as possible.
+	 */
+	std::vector<GLuint> simplify(
+		const MeshData& data,
+		const std::vector<GLuint>& elems,
+		size_t targetTris);
+
+	/* Returns a chain of element lists for data, starting with data.e,
+	 * each level having around ratio times as many triangles as the
+	 * last, stopping after nLevels levels or when no further
+	 * simplification is possible.
+	 */
+	std::vector<std::vector<GLuint>> buildLODChain(
+		const MeshData& data,
+		int nLevels,
+		float ratio);
+
+	/* Returns a standalone mesh containing only the vertices used by elems. */
+	MeshData extract(const MeshData& data, const std::vector<GLuint>& elems);
+}
+
+#endif
@@ -1,9 +1,11 @@
 #include "PRTMesh.hpp"
 
 #include "Mesh.hpp"
+#include "Scene.hpp"
 #include "Intersect.hpp"
 #include "SH.hpp"
 #include "Texture.hpp"
+#include "GC.hpp"
 
 #include "SOIL.h"
 
@@ -14,27 +16,36 @@
 PRTMesh::PRTMesh(
 	const std::string& bakedFilename,
 	SHShader* shader)
-	:Renderable(false), shader(shader)
+	:Renderable(false), shader(shader), geometry(nullptr)
 {
-	std::vector<PRTMeshVertex> mesh;
-	std::vector<GLushort> elems;
-	std::vector<std::string> coefftFilenames;
+	const std::string key = "PRTMesh " + bakedFilename;
+	geometry = static_cast<PRTMeshGeometry*>(MeshGeometry::find(key));
 
-	try
-	{
-		readPrebakedFile(mesh, elems, coefftFilenames, "../models/" + bakedFilename);
-	} 
-	catch(const MeshFileException& e)
+	if(!geometry)
 	{
-		std::cout << e.msg;
-		return;
+		std::vector<PRTMeshVertex> mesh;
+		std::vector<std::vector<GLuint>> levels(1);
+		std::vector<std::string> coefftFilenames;
+
+		try
+		{
+			readPrebakedFile(mesh, levels, coefftFilenames, "../models/" + bakedFilename);
+		} 
+		catch(const MeshFileException& e)
+		{
+			std::cout << e.msg;
+			return;
+		}
+
+		PRTMeshGeometry* geom = createGeometry(mesh, levels);
+		geom->arrTex = new ArrayTexture(coefftFilenames);
+		geometry = static_cast<PRTMeshGeometry*>(MeshGeometry::share(key, geom));
 	}
-	arrTex = new ArrayTexture(coefftFilenames);
 
-	init(mesh, elems);
+	init();
 }
 
-PRTMesh::~PRTMesh()
+PRTMeshGeometry::~PRTMeshGeometry()
 {
 	delete arrTex;
 }
@@ -201,7 +212,10 @@ void PRTMesh::bake(
 	PRTMesh::writeTransferToTextures(transfer, 
 		data, bakedFilename + genExt(mode, nBands), coefftFilenames, width, height);
 
-	PRTMesh::writePrebakedFile(mesh, data.e, coefftFilenames, 
+	std::vector<std::vector<GLuint>> levels(1, data.e);
+	levels.insert(levels.end(), data.lods.begin(), data.lods.end());
+
+	PRTMesh::writePrebakedFile(mesh, levels, coefftFilenames, 
 		"../models/" + bakedFilename + genExt(mode, nBands));
 }
 
@@ -229,7 +243,7 @@ std::string PRTMesh::genExt(PRTMode mode, int nBands)
 
 void PRTMesh::writePrebakedFile(
 	const std::vector<PRTMeshVertex>& mesh,
-	const std::vector<GLushort>& elems,
+	const std::vector<std::vector<GLuint>>& levels,
 	const std::vector<std::string>& coefftTex,
 	const std::string& filename)
 {
@@ -251,8 +265,12 @@ void PRTMesh::writePrebakedFile(
 
 	file << "Elements" << std::endl;
 
-	for(auto e = elems.begin(); e != elems.end(); ++e)
-		file << *e << std::endl;
+	for(auto l = levels.begin(); l != levels.end(); ++l)
+	{
+		if(l != levels.begin()) file << "LOD Elements" << std::endl;
+		for(auto e = l->begin(); e != l->end(); ++e)
+			file << *e << std::endl;
+	}
 
 	file << "Coefft Textures" << std::endl;
 
@@ -264,7 +282,7 @@ void PRTMesh::writePrebakedFile(
 
 void PRTMesh::readPrebakedFile(
 	std::vector<PRTMeshVertex>& mesh,
-	std::vector<GLushort>& elems,
+	std::vector<std::vector<GLuint>>& levels,
 	std::vector<std::string>& coefftFilenames,
  	const std::string& filename)
 {
@@ -297,19 +315,27 @@ void PRTMesh::readPrebakedFile(
 	file.clear();
 	file.getline(ignore, 30); //Throw the "Elements" line.
 
-	int elem;
+	GLuint elem;
 	while(file >> elem)
-		elems.push_back(static_cast<GLushort>(elem));
+		levels[0].push_back(elem);
 
+	/* Any coarser LODs follow, each under its own header. */
 	file.clear();
-	file.getline(ignore, 30); //Throw the "Coefft Textures" line.
+	file.getline(ignore, 30);
+	while(std::string(ignore) == "LOD Elements")
+	{
+		levels.push_back(std::vector<GLuint>());
+		while(file >> elem)
+			levels.back().push_back(elem);
+		file.clear();
+		file.getline(ignore, 30);
+	}
+	//ignore now holds the "Coefft Textures" line.
 
 	char coefftFilename[40];
 	while(file.getline(coefftFilename, 40))
 		coefftFilenames.push_back(std::string(coefftFilename));
 
-	numElems = elems.size();
-
 	file.close();
 }
 
@@ -514,7 +540,7 @@ void PRTMesh::renderCoefftToTexture(
 	GLuint elem_ebo;
 	glGenBuffers(1, &elem_ebo);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elem_ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * data.e.size(), data.e.data(), GL_STATIC_DRAW);
+	GLenum elemType = bufferElements(data.e);
 	
 	// Rendering setup
 	// Store current state
@@ -541,7 +567,7 @@ void PRTMesh::renderCoefftToTexture(
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 	// Render
-	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(data.e.size()), GL_UNSIGNED_SHORT, 0);
+	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(data.e.size()), elemType, 0);
 
 	// Rendering cleanup
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
@@ -550,7 +576,7 @@ void PRTMesh::renderCoefftToTexture(
 	glDeleteBuffers(1, &tex_vbo);
 	glDeleteBuffers(1, &coefft_vbo);
 	glDeleteBuffers(1, &elem_ebo);
-	glUseProgram(0);
+	Shader::unbind();
 	//Restore old state
 	if(faceCull == GL_TRUE) glEnable(GL_CULL_FACE);
 	else glDisable(GL_CULL_FACE);
@@ -618,58 +644,124 @@ glm::vec3 PRTMesh::texLookup(
 	return glm::vec3(r, g, b);
 }
 
-void PRTMesh::init(
+PRTMeshGeometry* PRTMesh::createGeometry(
 	const std::vector<PRTMeshVertex>& mesh,
-	const std::vector<GLushort>& elems)
+	const std::vector<std::vector<GLuint>>& levels)
 {
-	numElems = elems.size();
-	shader->setTexUnit(arrTex->getTexUnit());
+	PRTMeshGeometry* geom = new PRTMeshGeometry();
+	geom->packed = GC::packVertices;
+
+	std::vector<glm::vec4> verts;
+	for(auto v = mesh.begin(); v != mesh.end(); ++v)
+		verts.push_back(v->v);
+
+	glGenBuffers(1, &geom->v_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, geom->v_vbo);
+
+	if(GC::packVertices)
+	{
+		geom->posBounds = VertexPacking::bounds(verts);
+
+		std::vector<PackedPRTMeshVertex> packed(mesh.size());
+		for(unsigned i = 0; i < mesh.size(); ++i)
+		{
+			VertexPacking::packPosition(mesh[i].v, geom->posBounds, packed[i].v);
+			VertexPacking::packTexCoord(mesh[i].t, packed[i].t);
+		}
+
+		glBufferData(GL_ARRAY_BUFFER, sizeof(PackedPRTMeshVertex) * packed.size(),
+			packed.data(), GL_STATIC_DRAW);
+		VertexPacking::reportSaving("PRTMesh", mesh.size(), 
+			sizeof(PackedPRTMeshVertex), sizeof(PRTMeshVertex));
+	}
+	else
+		glBufferData(GL_ARRAY_BUFFER, sizeof(PRTMeshVertex) * mesh.size(),
+			mesh.data(), GL_STATIC_DRAW);
 
-	glGenBuffers(1, &v_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, v_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(PRTMeshVertex) * mesh.size(),
-		mesh.data(), GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glGenBuffers(1, &e_ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, e_ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * elems.size(),
-		elems.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	geom->lods.init(levels, verts);
+
+	return geom;
+}
+
+void PRTMesh::init()
+{
+	shader->setTexUnit(geometry->arrTex->getTexUnit());
 
 	v_attrib = shader->getAttribLoc("vPosition");
 	t_attrib = shader->getAttribLoc("vTexCoord");
+	inst_attrib = shader->findAttribLoc("vInstance");
 
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao);
 
-	glBindBuffer(GL_ARRAY_BUFFER, v_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, geometry->v_vbo);
 	glEnableVertexAttribArray(v_attrib);
 	glEnableVertexAttribArray(t_attrib);
-	glVertexAttribPointer(v_attrib, 4, GL_FLOAT, GL_FALSE, sizeof(PRTMeshVertex),
-		reinterpret_cast<GLvoid*>(offsetof(PRTMeshVertex, v)));
-	glVertexAttribPointer(t_attrib, 2, GL_FLOAT, GL_FALSE, sizeof(PRTMeshVertex), 
-		reinterpret_cast<GLvoid*>(offsetof(PRTMeshVertex, t)));
+	if(GC::packVertices)
+	{
+		glVertexAttribPointer(v_attrib, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedPRTMeshVertex),
+			reinterpret_cast<GLvoid*>(offsetof(PackedPRTMeshVertex, v)));
+		glVertexAttribPointer(t_attrib, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedPRTMeshVertex), 
+			reinterpret_cast<GLvoid*>(offsetof(PackedPRTMeshVertex, t)));
+	}
+	else
+	{
+		glVertexAttribPointer(v_attrib, 4, GL_FLOAT, GL_FALSE, sizeof(PRTMeshVertex),
+			reinterpret_cast<GLvoid*>(offsetof(PRTMeshVertex, v)));
+		glVertexAttribPointer(t_attrib, 2, GL_FLOAT, GL_FALSE, sizeof(PRTMeshVertex), 
+			reinterpret_cast<GLvoid*>(offsetof(PRTMeshVertex, t)));
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if(inst_attrib != -1) instances.attach(inst_attrib);
 
 	glBindVertexArray(0);
 }
 
+void PRTMesh::setInstances(const std::vector<glm::mat4>& transforms)
+{
+	if(inst_attrib == -1 && !transforms.empty())
+	{
+		std::cout << "Shader " << shader->filename << " does not support instancing.\n";
+		return;
+	}
+	instances.set(transforms);
+}
+
+bool PRTMesh::getWorldBounds(BoundingVolume& bounds)
+{
+	if(!geometry) return false;
+
+	if(instances.size() > 0)
+		bounds = instances.bounds(geometry->lods.getBounds()).transformed(modelToWorld);
+	else
+		bounds = geometry->lods.getBounds().transformed(modelToWorld);
+
+	return true;
+}
+
 void PRTMesh::render()
 {
-	if(!scene) return;
+	if(!scene || !geometry) return;
 	
 	shader->setModelToWorld(modelToWorld);
+	shader->setPackedVerts(GC::packVertices, 
+		geometry->posBounds.offset, geometry->posBounds.scale);
+	shader->setInstanced(instances.size() > 0);
 
-	shader->setTexUnit(arrTex->getTexUnit());
+	shader->setTexUnit(geometry->arrTex->getTexUnit());
 
 	shader->use();
 
 	glBindVertexArray(vao);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, e_ebo);
 
-	glDrawElements(GL_TRIANGLES, (GLsizei) numElems, GL_UNSIGNED_SHORT, 0);
+	if(instances.size() > 0)
+		instances.draw(geometry->lods, modelToWorld, scene->camera);
+	else
+		geometry->lods.draw(geometry->lods.select(modelToWorld, scene->camera));
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
-
-	glUseProgram(0);
 }
@@ -10,6 +10,8 @@
 #include <vector>
 
 #include "Shader.hpp"
+#include "MeshGeometry.hpp"
+#include "InstanceBuffer.hpp"
 
 class ArrayTexture;
 
@@ -21,14 +23,33 @@ struct PRTMeshVertex
 	glm::vec2 t; //Texture coord
 };
 
+struct PackedPRTMeshVertex
+{
+	GLushort v[4]; //Quantised position
+	GLhalf   t[2]; //Texture coord
+};
+
 struct MeshData;
 
+/* PRTMeshGeometry
+ * Geometry shared by PRTMeshes loaded from the same prebaked
+ *   file, along with its transfer coefficient textures.
+ */
+struct PRTMeshGeometry : public MeshGeometry
+{
+	PRTMeshGeometry() :arrTex(nullptr) {};
+	~PRTMeshGeometry();
+	ArrayTexture* arrTex;
+};
+
 /* PRTMesh
  * Class representing an object rendered using
  * diffuse PRT. 
  * Intended to be used by first calling bake() to
  * create a pre-baked file, and then loading this
  * via the constructor to create PRTMesh objects.
+ * PRTMeshes loaded from the same file share their geometry, and
+ * one PRTMesh can draw many copies of itself via setInstances().
  */
 class PRTMesh : public Renderable
 {
@@ -36,7 +57,6 @@ public:
 	PRTMesh(
 		const std::string& bakedFilename,
 		SHShader* shader);
-	~PRTMesh();
 
 	static void bake(
 		PRTMode mode,
@@ -50,12 +70,18 @@ public:
 	void render();
 	void update(int dTime) {};
 	Shader* getShader() {return static_cast<Shader*>(shader);};
+	GLuint getVAO() {return vao;};
+	bool getWorldBounds(BoundingVolume& bounds);
+	const void* getTextureSet() {return geometry;};
+
+	/* As Mesh::setInstances(). */
+	void setInstances(const std::vector<glm::mat4>& transforms);
 private:
 	static std::string genExt(PRTMode mode, int nBands);
 
 	void readPrebakedFile(
 		std::vector<PRTMeshVertex>& mesh,
-		std::vector<GLushort>& elems,
+		std::vector<std::vector<GLuint>>& levels,
 		std::vector<std::string>& coefftFilenames,
 	 	const std::string& filename);
 
@@ -67,7 +93,7 @@ private:
 
 	static void writePrebakedFile(
 		const std::vector<PRTMeshVertex>& mesh,
-		const std::vector<GLushort>& elems,
+		const std::vector<std::vector<GLuint>>& levels,
 		const std::vector<std::string>& coefftTex,
 		const std::string& filename);
 
@@ -89,20 +115,19 @@ private:
 		std::vector<std::string>& coefftFilenames,
 		int width, int height);
 
-	void init(
+	static PRTMeshGeometry* createGeometry(
 		const std::vector<PRTMeshVertex>& mesh,
-		const std::vector<GLushort>& elems);
+		const std::vector<std::vector<GLuint>>& levels);
+	void init();
 
 	SHShader* shader;
-	size_t numElems;
-
-	ArrayTexture* arrTex;
+	PRTMeshGeometry* geometry;
+	InstanceBuffer instances;
 
 	GLuint vao;
-	GLuint v_vbo;
-	GLuint e_ebo;
 	GLuint v_attrib;
 	GLuint t_attrib;
+	GLint inst_attrib;
 };
 
 #endif
@@ -0,0 +1,276 @@
+#include "ParticleKernel.hpp"
+
+#include "ParticleKernelSIMD.hpp"
+#include "ParticleStore.hpp"
+#include "ForceField.hpp"
+#include "GC.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef PARTICLEKERNEL_X86
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace
+{
+	unsigned next(unsigned& s)
+	{
+		s ^= s << 13;
+		s ^= s >> 17;
+		s ^= s << 5;
+		return s;
+	}
+
+	float unitFloat(unsigned x)
+	{
+		return static_cast<float>(static_cast<int>(x >> 8)) * (1.0f / 16777216.0f);
+	}
+
+	int randRange(unsigned& s, int var)
+	{
+		return static_cast<int>(unitFloat(next(s)) * static_cast<float>(2 * var)) - var;
+	}
+
+	void sinCos(float x, float& s, float& c)
+	{
+		const bool hi = x > 0.5f * PI;
+		const bool lo = -0.5f * PI > x;
+		float y = hi ? PI - x : x;
+		y = lo ? -PI - x : y;
+
+		float y2 = y * y;
+		float poly = -1.0f / 5040.0f + y2 * (1.0f / 362880.0f);
+		poly = 1.0f / 120.0f + y2 * poly;
+		poly = -1.0f / 6.0f + y2 * poly;
+		poly = 1.0f + y2 * poly;
+		s = y * poly;
+
+		c = std::sqrt(std::max(0.0f, 1.0f - s * s));
+		if(hi || lo) c = 0.0f - c;
+	}
+
+	void diskPoint(unsigned& s, float radius, float& x, float& z)
+	{
+		float angle = unitFloat(next(s)) * (2.0f * PI) - PI;
+		float r = unitFloat(next(s)) * radius;
+		float sn, cs;
+		sinCos(angle, sn, cs);
+		x = r * cs;
+		z = r * sn;
+	}
+
+#ifdef PARTICLEKERNEL_X86
+	struct SSE2Ops
+	{
+		typedef __m128 F;
+		typedef __m128i I;
+		static const int width = 4;
+
+		static F set1(float f) {return _mm_set1_ps(f);}
+		static F load(const float* p) {return _mm_load_ps(p);}
+		static void store(float* p, F a) {_mm_store_ps(p, a);}
+		static F add(F a, F b) {return _mm_add_ps(a, b);}
+		static F sub(F a, F b) {return _mm_sub_ps(a, b);}
+		static F mul(F a, F b) {return _mm_mul_ps(a, b);}
+		static F div(F a, F b) {return _mm_div_ps(a, b);}
+		static F max(F a, F b) {return _mm_max_ps(a, b);}
+		static F min(F a, F b) {return _mm_min_ps(a, b);}
+
+		static I set1i(int i) {return _mm_set1_epi32(i);}
+		static I loadi(const void* p) {return _mm_load_si128(static_cast<const I*>(p));}
+		static I addi(I a, I b) {return _mm_add_epi32(a, b);}
+		static I subi(I a, I b) {return _mm_sub_epi32(a, b);}
+
+		static F toFloat(I a) {return _mm_cvtepi32_ps(a);}
+		static I truncate(F a) {return _mm_cvttps_epi32(a);}
+
+		/* SSE2 has no gather, so load each lane. */
+		static F gather(const float* base, I index)
+		{
+			int i[4];
+			_mm_storeu_si128(reinterpret_cast<I*>(i), index);
+			return _mm_set_ps(base[i[3]], base[i[2]], base[i[1]], base[i[0]]);
+		}
+	};
+
+	void cpuid(int leaf, unsigned regs[4])
+	{
+#ifdef _MSC_VER
+		int r[4];
+		__cpuidex(r, leaf, 0);
+		for(int i = 0; i < 4; ++i) regs[i] = static_cast<unsigned>(r[i]);
+#else
+		__cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	}
+
+	bool detectSSE2()
+	{
+		unsigned regs[4];
+		cpuid(1, regs);
+		return (regs[3] & (1u << 26)) != 0;
+	}
+
+	bool detectAVX2()
+	{
+		unsigned regs[4];
+		cpuid(0, regs);
+		if(regs[0] < 7) return false;
+
+		/* The OS must save the AVX registers (XCR0 bits 1 and 2). */
+		cpuid(1, regs);
+		const unsigned osxsave = 1u << 27, avx = 1u << 28;
+		if((regs[2] & (osxsave | avx)) != (osxsave | avx)) return false;
+#ifdef _MSC_VER
+		unsigned long long xcr0 = _xgetbv(0);
+#else
+		unsigned lo, hi;
+		__asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+		unsigned long long xcr0 = (static_cast<unsigned long long>(hi) << 32) | lo;
+#endif
+		if((xcr0 & 6) != 6) return false;
+
+		cpuid(7, regs);
+		return (regs[1] & (1u << 5)) != 0;
+	}
+
+	const bool hasSSE2 = detectSSE2();
+	const bool hasAVX2 = hasSSE2 && detectAVX2();
+#else
+	const bool hasSSE2 = false;
+	const bool hasAVX2 = false;
+#endif
+
+	ParticleKernel::Kernel current =
+		hasAVX2 ? ParticleKernel::AVX2 :
+		hasSSE2 ? ParticleKernel::SSE2 : ParticleKernel::SCALAR;
+}
+
+void ParticleKernel::update(ParticleStore& store, int begin, int end, const Params& params)
+{
+	switch(current)
+	{
+	case AVX2: updateAVX2(store, begin, end, params); break;
+	case SSE2: updateSSE2(store, begin, end, params); break;
+	default:   updateScalar(store, begin, end, params); break;
+	}
+}
+
+ParticleKernel::Kernel ParticleKernel::getKernel()
+{
+	return current;
+}
+
+bool ParticleKernel::setKernel(Kernel kernel)
+{
+	if(!isSupported(kernel)) return false;
+	current = kernel;
+	return true;
+}
+
+bool ParticleKernel::isSupported(Kernel kernel)
+{
+	switch(kernel)
+	{
+	case AVX2: return hasAVX2;
+	case SSE2: return hasSSE2;
+	default:   return true;
+	}
+}
+
+const char* ParticleKernel::getName(Kernel kernel)
+{
+	switch(kernel)
+	{
+	case AVX2: return "AVX2";
+	case SSE2: return "SSE2";
+	default:   return "scalar";
+	}
+}
+
+void ParticleKernel::updateScalar(ParticleStore& p, int begin, int end, const Params& k)
+{
+	const float dt = k.dt;
+	const int stride = p.getPaddedSize();
+
+	for(int i = begin; i < end; ++i)
+	{
+		p.prevX[i] = p.px[i]; p.prevY[i] = p.py[i]; p.prevZ[i] = p.pz[i];
+		p.decay[i] = static_cast<float>(k.now - p.birth[i]) / static_cast<float>(p.lifeTime[i]);
+		glm::vec3 acn = k.force;
+		if(k.field)
+		{
+			const glm::vec3 f = k.field->sample(p.px[i], p.py[i], p.pz[i]);
+			acn = glm::vec3(acn.x + f.x, acn.y + f.y, acn.z + f.z);
+		}
+		p.vx[i] = p.vx[i] + dt * (acn.x - (p.px[i] - p.originX[i]) * k.centerForce);
+		p.vy[i] = p.vy[i] + dt * acn.y;
+		p.vz[i] = p.vz[i] + dt * (acn.z - (p.pz[i] - p.originZ[i]) * k.centerForce);
+		p.px[i] = p.px[i] + dt * p.vx[i];
+		p.py[i] = p.py[i] + dt * p.vy[i];
+		p.pz[i] = p.pz[i] + dt * p.vz[i];
+
+		if(k.view)
+		{
+			k.view[i] = p.prevX[i] + k.alpha * (p.px[i] - p.prevX[i]);
+			k.view[stride + i] = p.prevY[i] + k.alpha * (p.py[i] - p.prevY[i]);
+			k.view[2 * stride + i] = p.prevZ[i] + k.alpha * (p.pz[i] - p.prevZ[i]);
+			k.view[3 * stride + i] = p.decay[i];
+			k.view[4 * stride + i] = p.randTex[i];
+		}
+	}
+}
+
+void ParticleKernel::spawn(ParticleStore& p, int begin, int end, const Params& k,
+	const glm::vec3& origin)
+{
+	for(int i = begin; i < end; ++i)
+	{
+		p.originX[i] = origin.x; p.originY[i] = origin.y; p.originZ[i] = origin.z;
+		respawn(p, i, k);
+	}
+}
+
+void ParticleKernel::respawn(ParticleStore& p, int i, const Params& k)
+{
+	unsigned s = p.seed[i];
+	p.lifeTime[i] = std::max(1, k.avgLifetime + randRange(s, k.varLifetime));
+	p.perturbAt[i] = k.now + k.avgPerturbTime + randRange(s, k.varPerturbTime);
+	float sx, sz;
+	diskPoint(s, k.baseRadius, sx, sz);
+	p.randTex[i] = unitFloat(next(s));
+	p.seed[i] = s;
+
+	p.birth[i] = k.now;
+	p.px[i] = p.originX[i] + sx; p.py[i] = p.originY[i]; p.pz[i] = p.originZ[i] + sz;
+	p.vx[i] = sx * k.initVel; p.vy[i] = k.initUpVel; p.vz[i] = sz * k.initVel;
+}
+
+void ParticleKernel::perturb(ParticleStore& p, int i, const Params& k)
+{
+	unsigned s = p.seed[i];
+	p.perturbAt[i] = k.now + k.avgPerturbTime + randRange(s, k.varPerturbTime);
+	if(k.perturbOn)
+	{
+		float dvx, dvz;
+		diskPoint(s, k.perturbRadius, dvx, dvz);
+		p.vx[i] = p.vx[i] + dvx;
+		p.vz[i] = p.vz[i] + dvz;
+	}
+	p.seed[i] = s;
+}
+
+void ParticleKernel::updateSSE2(ParticleStore& store, int begin, int end, const Params& params)
+{
+#ifdef PARTICLEKERNEL_X86
+	ParticleKernelSIMD::update<SSE2Ops>(store, begin, end, params);
+#else
+	updateScalar(store, begin, end, params);
+#endif
+}
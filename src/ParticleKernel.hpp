@@ -0,0 +1,79 @@
+#ifndef PARTICLEKERNEL_HPP
+#define PARTICLEKERNEL_HPP
+
+#include <glm.hpp>
+
+class ParticleStore;
+class ForceField;
+
+/* ParticleKernel
+ * Advances a range of a ParticleStore by one timestep: updating decay,
+ *   and integrating the centering force, constant force, and any
+ *   force field. Particles are pulled towards their origin.
+ * Positions at the start of the step are kept in the store's prev
+ *   streams.
+ * Respawns and perturbations are events, due at absolute times kept
+ *   in the store (birth + lifeTime, and perturbAt), which the owner
+ *   schedules and handles with respawn() and perturb() before
+ *   update(), so update() is the same branch-free arithmetic for
+ *   every particle.
+ * spawn(), respawn() and perturb() draw random numbers from each
+ *   particle's own xorshift generator (the store's seed stream).
+ *   spawn() initialises newly added particles about an origin, and
+ *   respawn() reinitialises a dead one about its own; update() must
+ *   follow in the same step, to set their prev streams and decay.
+ *   They are scalar, as events are few.
+ * update() runs the fastest kernel the CPU supports: AVX2 (8
+ *   particles per iteration), SSE2 (4), or the scalar reference,
+ *   which the others match to within rounding. begin and end must
+ *   be multiples of ParticleStore::simdWidth.
+ */
+namespace ParticleKernel
+{
+	struct Params
+	{
+		int now;   //Time at the end of the step, on the store's clock, in ms.
+		float dt;  //Integration timestep, in ms.
+		glm::vec3 force; //Constant acceleration, e.g. initAcn + extForce.
+		const ForceField* field; //Added to force where not null.
+		float centerForce;
+		int avgLifetime;
+		int varLifetime;
+		bool perturbOn;
+		int avgPerturbTime;
+		int varPerturbTime;
+		float perturbRadius;
+		float baseRadius;
+		float initVel;
+		float initUpVel;
+		/* If not null, the GPU view (see ParticleStore) is written here
+		 * as well as to the store, laid out as the store's and aligned
+		 * to 32 bytes. Its positions are interpolated by alpha from
+		 * the start (0) to the end (1) of the step. */
+		float* view;
+		float alpha;
+	};
+
+	enum Kernel {SCALAR, SSE2, AVX2};
+
+	void update(ParticleStore& store, int begin, int end, const Params& params);
+	void spawn(ParticleStore& store, int begin, int end, const Params& params,
+		const glm::vec3& origin);
+	void respawn(ParticleStore& store, int index, const Params& params);
+	/* Reschedules the particle's next perturbation, perturbing its
+	 * velocity if params.perturbOn. */
+	void perturb(ParticleStore& store, int index, const Params& params);
+
+	/* The kernel used by update(), by default the best supported. */
+	Kernel getKernel();
+	/* Returns false, leaving the kernel unchanged, if unsupported. */
+	bool setKernel(Kernel kernel);
+	bool isSupported(Kernel kernel);
+	const char* getName(Kernel kernel);
+
+	void updateScalar(ParticleStore& store, int begin, int end, const Params& params);
+	void updateSSE2(ParticleStore& store, int begin, int end, const Params& params);
+	void updateAVX2(ParticleStore& store, int begin, int end, const Params& params);
+}
+
+#endif
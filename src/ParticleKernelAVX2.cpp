@@ -0,0 +1,50 @@
+#include "ParticleKernel.hpp"
+
+#include "ParticleKernelSIMD.hpp"
+
+/* Compiled with AVX2 enabled (-mavx2 on GCC and Clang; MSVC needs no
+ * flag for intrinsics), and only called once CPUID reports AVX2, so
+ * nothing here may be inlined into code run on other CPUs.
+ */
+#ifdef PARTICLEKERNEL_X86
+#include <immintrin.h>
+
+namespace
+{
+	struct AVX2Ops
+	{
+		typedef __m256 F;
+		typedef __m256i I;
+		static const int width = 8;
+
+		static F set1(float f) {return _mm256_set1_ps(f);}
+		static F load(const float* p) {return _mm256_load_ps(p);}
+		static void store(float* p, F a) {_mm256_store_ps(p, a);}
+		static F add(F a, F b) {return _mm256_add_ps(a, b);}
+		static F sub(F a, F b) {return _mm256_sub_ps(a, b);}
+		static F mul(F a, F b) {return _mm256_mul_ps(a, b);}
+		static F div(F a, F b) {return _mm256_div_ps(a, b);}
+		static F max(F a, F b) {return _mm256_max_ps(a, b);}
+		static F min(F a, F b) {return _mm256_min_ps(a, b);}
+
+		static I set1i(int i) {return _mm256_set1_epi32(i);}
+		static I loadi(const void* p) {return _mm256_load_si256(static_cast<const I*>(p));}
+		static I addi(I a, I b) {return _mm256_add_epi32(a, b);}
+		static I subi(I a, I b) {return _mm256_sub_epi32(a, b);}
+
+		static F toFloat(I a) {return _mm256_cvtepi32_ps(a);}
+		static I truncate(F a) {return _mm256_cvttps_epi32(a);}
+		static F gather(const float* base, I index) {return _mm256_i32gather_ps(base, index, 4);}
+	};
+}
+
+void ParticleKernel::updateAVX2(ParticleStore& store, int begin, int end, const Params& params)
+{
+	ParticleKernelSIMD::update<AVX2Ops>(store, begin, end, params);
+}
+#else
+void ParticleKernel::updateAVX2(ParticleStore& store, int begin, int end, const Params& params)
+{
+	updateScalar(store, begin, end, params);
+}
+#endif
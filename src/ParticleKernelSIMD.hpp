@@ -0,0 +1,139 @@
+#ifndef PARTICLEKERNELSIMD_HPP
+#define PARTICLEKERNELSIMD_HPP
+
+#include "ParticleKernel.hpp"
+#include "ParticleStore.hpp"
+#include "ForceField.hpp"
+#include "GC.hpp"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define PARTICLEKERNEL_X86
+#endif
+
+/* The SIMD kernels, written once over an instruction set V giving
+ *   float (F) and int (I) vectors of V::width lanes.
+ * Only ParticleKernel.cpp (SSE2) and ParticleKernelAVX2.cpp include
+ *   this, each compiled for its own instruction set.
+ * Each step mirrors ParticleKernel::updateScalar(), so any change
+ *   must be made to both.
+ */
+namespace ParticleKernelSIMD
+{
+	template<class V>
+	inline typename V::F lerp(typename V::F a, typename V::F b, typename V::F t)
+	{
+		return V::add(a, V::mul(t, V::sub(b, a)));
+	}
+
+	/* Trilinear interpolation of one component stream, from the eight
+	 * corners of the cells starting at index i. */
+	template<class V>
+	inline typename V::F trilinear(const float* stream, typename V::I i,
+		const typename V::I corners[8], typename V::F tx, typename V::F ty, typename V::F tz)
+	{
+		typedef typename V::F F;
+		F c[8];
+		for(int k = 0; k < 8; ++k) c[k] = V::gather(stream, V::addi(i, corners[k]));
+		const F a00 = lerp<V>(c[0], c[1], tx);
+		const F a10 = lerp<V>(c[2], c[3], tx);
+		const F a01 = lerp<V>(c[4], c[5], tx);
+		const F a11 = lerp<V>(c[6], c[7], tx);
+		return lerp<V>(lerp<V>(a00, a10, ty), lerp<V>(a01, a11, ty), tz);
+	}
+
+	/* Mirrors ForceField::sample(). */
+	template<class V>
+	inline void sampleField(const ForceField& f, typename V::F x, typename V::F y,
+		typename V::F z, typename V::F& ax, typename V::F& ay, typename V::F& az)
+	{
+		typedef typename V::F F;
+		typedef typename V::I I;
+		const int nx = f.getNX(), ny = f.getNY(), nz = f.getNZ();
+		const glm::vec3& lo = f.getMin();
+		const glm::vec3& scale = f.getInvCellSize();
+		const F zero = V::set1(0.0f);
+
+		const F gx = V::min(V::max(V::mul(V::sub(x, V::set1(lo.x)), V::set1(scale.x)), zero),
+			V::set1(static_cast<float>(nx - 1)));
+		const F gy = V::min(V::max(V::mul(V::sub(y, V::set1(lo.y)), V::set1(scale.y)), zero),
+			V::set1(static_cast<float>(ny - 1)));
+		const F gz = V::min(V::max(V::mul(V::sub(z, V::set1(lo.z)), V::set1(scale.z)), zero),
+			V::set1(static_cast<float>(nz - 1)));
+		const F cx = V::toFloat(V::truncate(V::min(gx, V::set1(static_cast<float>(nx - 2)))));
+		const F cy = V::toFloat(V::truncate(V::min(gy, V::set1(static_cast<float>(ny - 2)))));
+		const F cz = V::toFloat(V::truncate(V::min(gz, V::set1(static_cast<float>(nz - 2)))));
+		const F tx = V::sub(gx, cx), ty = V::sub(gy, cy), tz = V::sub(gz, cz);
+		const I i = V::truncate(V::add(cx, V::mul(V::set1(static_cast<float>(nx)),
+			V::add(cy, V::mul(V::set1(static_cast<float>(ny)), cz)))));
+
+		const int nxy = nx * ny;
+		const I corners[8] = {V::set1i(0), V::set1i(1), V::set1i(nx), V::set1i(nx + 1),
+			V::set1i(nxy), V::set1i(nxy + 1), V::set1i(nxy + nx), V::set1i(nxy + nx + 1)};
+		ax = trilinear<V>(f.getX(), i, corners, tx, ty, tz);
+		ay = trilinear<V>(f.getY(), i, corners, tx, ty, tz);
+		az = trilinear<V>(f.getZ(), i, corners, tx, ty, tz);
+	}
+
+	template<class V>
+	void update(ParticleStore& p, int begin, int end, const ParticleKernel::Params& k)
+	{
+		typedef typename V::F F;
+
+		const F dt = V::set1(k.dt);
+		const F alpha = V::set1(k.alpha);
+		const typename V::I now = V::set1i(k.now);
+		const F fx = V::set1(k.force.x);
+		const F fy = V::set1(k.force.y);
+		const F fz = V::set1(k.force.z);
+		const F centerForce = V::set1(k.centerForce);
+		const int stride = p.getPaddedSize();
+
+		for(int i = begin; i < end; i += V::width)
+		{
+			F x = V::load(p.px + i);
+			F y = V::load(p.py + i);
+			F z = V::load(p.pz + i);
+			F vx = V::load(p.vx + i);
+			F vy = V::load(p.vy + i);
+			F vz = V::load(p.vz + i);
+			const F ox = V::load(p.originX + i);
+			const F oz = V::load(p.originZ + i);
+			const F randTex = V::load(p.randTex + i);
+
+			V::store(p.prevX + i, x); V::store(p.prevY + i, y); V::store(p.prevZ + i, z);
+			const F x0 = x, y0 = y, z0 = z;
+			const F decay = V::div(V::toFloat(V::subi(now, V::loadi(p.birth + i))),
+				V::toFloat(V::loadi(p.lifeTime + i)));
+			F ax = fx, ay = fy, az = fz;
+			if(k.field)
+			{
+				F ffx, ffy, ffz;
+				sampleField<V>(*k.field, x, y, z, ffx, ffy, ffz);
+				ax = V::add(fx, ffx);
+				ay = V::add(fy, ffy);
+				az = V::add(fz, ffz);
+			}
+			vx = V::add(vx, V::mul(dt, V::sub(ax, V::mul(V::sub(x, ox), centerForce))));
+			vy = V::add(vy, V::mul(dt, ay));
+			vz = V::add(vz, V::mul(dt, V::sub(az, V::mul(V::sub(z, oz), centerForce))));
+			x = V::add(x, V::mul(dt, vx));
+			y = V::add(y, V::mul(dt, vy));
+			z = V::add(z, V::mul(dt, vz));
+
+			V::store(p.px + i, x); V::store(p.py + i, y); V::store(p.pz + i, z);
+			V::store(p.vx + i, vx); V::store(p.vy + i, vy); V::store(p.vz + i, vz);
+			V::store(p.decay + i, decay);
+
+			if(k.view)
+			{
+				V::store(k.view + i, V::add(x0, V::mul(alpha, V::sub(x, x0))));
+				V::store(k.view + stride + i, V::add(y0, V::mul(alpha, V::sub(y, y0))));
+				V::store(k.view + 2 * stride + i, V::add(z0, V::mul(alpha, V::sub(z, z0))));
+				V::store(k.view + 3 * stride + i, decay);
+				V::store(k.view + 4 * stride + i, randTex);
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,358 @@
+#include "ParticleSim.hpp"
+
+#include "GC.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+	/* Event slots of a few ms, shorter than most steps, spanning most
+	 * lifetimes. */
+	const int eventSlotTime = 4;
+	const int nEventSlots = 2048;
+}
+
+ParticleSim::ParticleSim(int nParticles)
+	:extForce(glm::vec4(0.0f)),
+	 field(nullptr),
+	 avgLifetime(3000), varLifetime(200),
+	 initAcn(glm::vec4(0.0, 0.0000004, 0.0, 0.0)),
+	 initVel(0.001f),
+	 initUpVel(0.0f),
+	 avgPerturbTime(1000), varPerturbTime(100),
+	 perturbRadius(0.0001f),
+	 baseRadius(0.2f),
+	 centerForce(6e-7f),
+	 perturbOn(true), initPerturb(false),
+	 maxSubsteps(GC::maxParticleSubsteps),
+	 respawn(true),
+	 particles(nParticles),
+	 accumulator(0.0f), timerCarry(0.0f), clock(0),
+	 events(eventSlotTime, nEventSlots),
+	 dueMask((nParticles + 31) / 32, 0u),
+	 lod(1.0f), lodPending(0.0f)
+{
+	height = initAcn.y * avgLifetime;
+	setStepRate(GC::particleStepRate);
+	reset();
+}
+
+void ParticleSim::reset()
+{
+	particles.clear();
+	events.clear(clock);
+	if(!respawn)
+	{
+		updateBounds();
+		return;
+	}
+
+	const int size = particles.add(particles.getSize());
+	for(int i = 0; i < size; ++i)
+	{
+		glm::vec4 pos = randInitPos();
+		particles.setPos(i, pos);
+		particles.originX[i] = particles.originY[i] = particles.originZ[i] = 0.0f;
+		particles.prevX[i] = pos.x;
+		particles.prevY[i] = pos.y;
+		particles.prevZ[i] = pos.z;
+		particles.decay[i] = 0.0f;
+		particles.randTex[i] = randf(0.0f, 1.0f);
+
+		particles.birth[i] = clock;
+		particles.lifeTime[i] = std::max(1, static_cast<int>(
+			(static_cast<long long>(avgLifetime) * i) / size));
+		particles.perturbAt[i] = clock + avgPerturbTime + randi(-varPerturbTime, varPerturbTime);
+
+		if(initPerturb) particles.setVel(i, perturb(getInitVel(pos)));
+		else particles.setVel(i, getInitVel(pos));
+
+		schedule(i);
+	}
+
+	updateBounds();
+}
+
+void ParticleSim::update(int dTime, int nThreads, float* view)
+{
+	step(dTime, static_cast<float>(dTime), nThreads, view, 1.0f);
+	updateBounds();
+}
+
+int ParticleSim::advance(int dTime, int nThreads, float* view)
+{
+	const float lodStepTime = getStepTime();
+	accumulator = std::min(accumulator + dTime, maxSubsteps * lodStepTime);
+	const int nSteps = static_cast<int>(accumulator / lodStepTime);
+	accumulator -= nSteps * lodStepTime;
+	const float alpha = accumulator / lodStepTime;
+
+	for(int s = 0; s < nSteps; ++s)
+	{
+		// The clock is in whole ms, so carry the fractions between steps.
+		timerCarry += lodStepTime;
+		const int timerStep = static_cast<int>(timerCarry);
+		timerCarry -= timerStep;
+
+		// Only the last step's results are drawn.
+		step(timerStep, lodStepTime, nThreads, s == nSteps - 1 ? view : 0, alpha);
+	}
+
+	if(nSteps > 0) updateBounds();
+	else if(view) interpolate(view, alpha, nThreads);
+
+	return nSteps;
+}
+
+int ParticleSim::addEmitter(const glm::vec3& origin, float rate)
+{
+	Emitter e;
+	e.origin = origin;
+	e.rate = rate;
+	e.burst = 0;
+	e.pending = 0.0f;
+	emitters.push_back(e);
+	return getNEmitters() - 1;
+}
+
+void ParticleSim::setStepRate(float stepRate)
+{
+	this->stepRate = std::max(GC::minParticleStepRate,
+		std::min(GC::maxParticleStepRate, stepRate));
+	stepTime = 1000.0f / this->stepRate;
+}
+
+void ParticleSim::setLOD(float lod)
+{
+	this->lod = std::max(GC::minParticleLOD, std::min(1.0f, lod));
+}
+
+float ParticleSim::getStepTime() const
+{
+	return std::max(stepTime, std::min(stepTime / lod, GC::maxParticleLODStep));
+}
+
+void ParticleSim::step(int dTime, float dt, int nThreads, float* view, float alpha)
+{
+	clock += dTime;
+
+	ParticleKernel::Params params;
+	params.now = clock;
+	params.dt = dt;
+	params.force = glm::vec3(initAcn + extForce);
+	params.field = field;
+	params.centerForce = centerForce;
+	params.avgLifetime = avgLifetime;
+	params.varLifetime = varLifetime;
+	params.perturbOn = perturbOn;
+	params.avgPerturbTime = avgPerturbTime;
+	params.varPerturbTime = varPerturbTime;
+	params.perturbRadius = perturbRadius;
+	params.baseRadius = baseRadius;
+	params.initVel = initVel;
+	params.initUpVel = initUpVel;
+	params.view = view;
+	params.alpha = alpha;
+
+	handleEvents(params);
+	applyLOD(dt, params);
+	emit(dt, params);
+
+	/* The kernels work a whole SIMD register at a time, so run over
+	 * the padding too; padding particles are never drawn. */
+	const int size = particles.getPaddedNLive();
+	const int chunkSize = 4096;
+	const int nChunks = (size + chunkSize - 1) / chunkSize;
+	#pragma omp parallel for num_threads(nThreads) if(nThreads > 1)
+	for(int c = 0; c < nChunks; ++c)
+		ParticleKernel::update(particles, c * chunkSize,
+			std::min((c + 1) * chunkSize, size), params);
+}
+
+/* Each particle has one event, at the earlier of its death and its
+ * next perturbation, identified by its index. */
+void ParticleSim::schedule(int index)
+{
+	events.schedule(nextEvent(index), static_cast<unsigned>(index));
+}
+
+int ParticleSim::nextEvent(int index) const
+{
+	return std::min(particles.birth[index] + particles.lifeTime[index],
+		particles.perturbAt[index]);
+}
+
+/* Respawns or removes the particles that die this step, and perturbs
+ * those due. Due events mark their particles in a bitmap, which is
+ * then read in order, so particles are handled in order of index, for
+ * locality. An event is stale if its particle has since been removed
+ * or moved, but its index may hold another due particle, so the
+ * particle is checked rather than the event. */
+void ParticleSim::handleEvents(const ParticleKernel::Params& params)
+{
+	events.advance(clock, dueEvents);
+	if(dueEvents.empty()) return;
+
+	const unsigned nLive = static_cast<unsigned>(particles.getNLive());
+	for(auto e = dueEvents.begin(); e != dueEvents.end(); ++e)
+		if(e->id < nLive) dueMask[e->id / 32] |= 1u << (e->id % 32);
+	dueEvents.clear();
+
+	const int nWords = static_cast<int>((nLive + 31) / 32);
+	for(int w = 0; w < nWords; ++w)
+	{
+		unsigned bits = dueMask[w];
+		dueMask[w] = 0;
+		for(int i = w * 32; bits != 0; ++i, bits >>= 1)
+		{
+			if(!(bits & 1) || i >= particles.getNLive() || nextEvent(i) > clock)
+				continue;
+
+			if(particles.birth[i] + particles.lifeTime[i] <= clock)
+			{
+				if(!respawn)
+				{
+					kill(i, params);
+					continue;
+				}
+				ParticleKernel::respawn(particles, i, params);
+			}
+			if(particles.perturbAt[i] <= clock)
+				ParticleKernel::perturb(particles, i, params);
+			schedule(i);
+		}
+	}
+}
+
+/* The last live particle moves into the hole, leaving its event stale,
+ * so it is handled here if due, and scheduled again under its new
+ * index. */
+void ParticleSim::kill(int index, const ParticleKernel::Params& params)
+{
+	do particles.remove(index);
+	while(index < particles.getNLive() &&
+		particles.birth[index] + particles.lifeTime[index] <= clock);
+
+	if(index < particles.getNLive())
+	{
+		if(particles.perturbAt[index] <= clock)
+			ParticleKernel::perturb(particles, index, params);
+		schedule(index);
+	}
+}
+
+void ParticleSim::emit(float dt, const ParticleKernel::Params& params)
+{
+	for(auto e = emitters.begin(); e != emitters.end(); ++e)
+	{
+		e->pending += e->rate * lod * dt / 1000.0f;
+		const int due = static_cast<int>(e->pending);
+		e->pending -= due;
+
+		// Particles there is no room for are dropped.
+		const int first = particles.getNLive();
+		const int added = particles.add(due + e->burst);
+		e->burst = 0;
+		ParticleKernel::spawn(particles, first, first + added, params, e->origin);
+		for(int i = first; i < first + added; ++i) schedule(i);
+	}
+}
+
+void ParticleSim::applyLOD(float dt, const ParticleKernel::Params& params)
+{
+	const int size = particles.getSize();
+	const int target = static_cast<int>(lod * size + 0.5f);
+	particles.truncate(target);
+
+	const int first = particles.getNLive();
+	if(!respawn || first >= target)
+	{
+		lodPending = 0.0f;
+		return;
+	}
+
+	lodPending += dt * size / std::max(1, avgLifetime);
+	const int due = static_cast<int>(lodPending);
+	lodPending -= due;
+	const int added = particles.add(std::min(due, target - first));
+	ParticleKernel::spawn(particles, first, first + added, params, glm::vec3(0.0f));
+	for(int i = first; i < first + added; ++i) schedule(i);
+}
+
+void ParticleSim::interpolate(float* view, float alpha, int nThreads)
+{
+	const ParticleStore& p = particles;
+	const int stride = p.getPaddedSize();
+	const int size = p.getPaddedNLive();
+	float* vx = view;
+	float* vy = view + stride;
+	float* vz = view + 2 * stride;
+	float* vDecay = view + 3 * stride;
+	float* vRandTex = view + 4 * stride;
+
+	#pragma omp parallel for num_threads(nThreads) if(nThreads > 1)
+	for(int i = 0; i < size; ++i)
+	{
+		vx[i] = p.prevX[i] + alpha * (p.px[i] - p.prevX[i]);
+		vy[i] = p.prevY[i] + alpha * (p.py[i] - p.prevY[i]);
+		vz[i] = p.prevZ[i] + alpha * (p.pz[i] - p.prevZ[i]);
+		vDecay[i] = p.decay[i];
+		vRandTex[i] = p.randTex[i];
+	}
+}
+
+void ParticleSim::updateBounds()
+{
+	const int size = particles.getNLive();
+	if(size == 0)
+	{
+		minPos = maxPos = glm::vec3(0.0f);
+		return;
+	}
+
+	minPos = maxPos = glm::vec3(particles.getPos(0));
+	for(int i = 0; i < size; ++i)
+	{
+		minPos.x = std::min(minPos.x, particles.px[i]);
+		minPos.y = std::min(minPos.y, particles.py[i]);
+		minPos.z = std::min(minPos.z, particles.pz[i]);
+		maxPos.x = std::max(maxPos.x, particles.px[i]);
+		maxPos.y = std::max(maxPos.y, particles.py[i]);
+		maxPos.z = std::max(maxPos.z, particles.pz[i]);
+	}
+}
+
+glm::vec4 ParticleSim::randInitPos()
+{
+	float theta = randf(0.0f, 2.0f * PI);
+	float radius = randf(0.0f, baseRadius);
+	return glm::vec4(radius*cos(theta), 0.0, radius*sin(theta), 1.0);
+}
+
+glm::vec4 ParticleSim::perturb(glm::vec4 input)
+{
+	float theta = randf(0.0f, 2.0f * PI);
+	float radius = randf(0.0f, perturbRadius);
+	return input + glm::vec4(radius * cos(theta), 0.0, radius * sin(theta), 0.0);
+}
+
+glm::vec4 ParticleSim::getInitVel(const glm::vec4& pos)
+{
+	return glm::vec4(pos.x, pos.y, pos.z, 0.0f) * initVel +
+		glm::vec4(0.0f, 1.0f, 0.0f, 0.0f) * initUpVel;
+
+}
+
+float ParticleSim::randf(float low, float high)
+{
+	float r = (float) rand() / (float) RAND_MAX;
+	return low + ((high - low) * r);
+}
+
+int ParticleSim::randi(int low, int high)
+{
+	int r = rand() % (high - low);
+	return r + low;
+}
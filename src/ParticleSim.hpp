@@ -0,0 +1,143 @@
+#ifndef PARTICLESIM_HPP
+#define PARTICLESIM_HPP
+
+#include "ParticleStore.hpp"
+#include "ParticleKernel.hpp"
+#include "TimingWheel.hpp"
+
+#include <glm.hpp>
+
+#include <vector>
+
+class ForceField;
+
+/* ParticleSim
+ * The simulation behind AdvectParticles (see there for the behaviour
+ *   of each parameter), with no GL resources, so it can be created and
+ *   stepped without a GL context, e.g. by the particle benchmark.
+ * The constructor spawns every particle. update() advances the live
+ *   particles by dTime ms on up to nThreads OpenMP threads, then
+ *   refits the bounds of their positions.
+ * By default (respawn) a particle respawns as soon as it dies, so the
+ *   pool is always full. Otherwise dead particles are removed from the
+ *   pool, and reset() empties it; particles then come only from
+ *   emitters, which emit rate particles/s plus any bursts about their
+ *   origins while there is room. Any number of emitters may share
+ *   the pool, and the cost of a step follows the number alive.
+ * advance() instead runs fixed steps of 1/stepRate s, as many as the
+ *   time passed (plus any left over from earlier calls) allows, up to
+ *   maxSubsteps; any more time is dropped, slowing the simulation
+ *   rather than letting a long frame make it unstable or fall ever
+ *   further behind. The positions it writes to the GPU view are
+ *   interpolated between the last two steps by the time left over.
+ * setLOD() scales the simulation down for distant systems: the live
+ *   particles (or emitter rates) are scaled by the LOD, and the steps
+ *   advance() runs lengthened by its inverse, up to
+ *   GC::maxParticleLODStep, so fewer particles are stepped less often.
+ *   Surplus particles are dropped at once; missing ones respawn at
+ *   the rate particles die, so the pool refills over a lifetime.
+ * Deaths and perturbations are scheduled on a TimingWheel as particles
+ *   spawn, so each step handles only the particles they fall due to,
+ *   and the kernel just integrates. This pays while events are rare,
+ *   e.g. seconds apart as by default; very short lifetimes or perturb
+ *   times make it slower than integrating alone.
+ */
+class ParticleSim
+{
+public:
+	ParticleSim(int nParticles);
+
+	struct Emitter
+	{
+		glm::vec3 origin;
+		float rate;    //Particles emitted per second.
+		int burst;     //Particles to emit at the next step, on top of rate.
+		float pending; //Fraction of a particle due but not yet emitted.
+	};
+
+	/* If view is not null, the GPU view of the particles is written
+	 * there too (see ParticleStore::getViewBytes()). */
+	void update(int dTime, int nThreads = 1, float* view = 0);
+	/* Returns the number of steps run. If view is not null, it is
+	 * always written, even if no steps were run. */
+	int advance(int dTime, int nThreads = 1, float* view = 0);
+	/* Clamped to [GC::minParticleStepRate, GC::maxParticleStepRate]. */
+	void setStepRate(float stepRate);
+	float getStepRate() const {return stepRate;};
+	/* Clamped to [GC::minParticleLOD, 1]. */
+	void setLOD(float lod);
+	float getLOD() const {return lod;};
+	/* Respawns every particle, with lifetimes spread evenly over
+	 * [0, avgLifetime] so the system stabilises quickly. */
+	void reset();
+
+	/* Returns the new emitter's index. */
+	int addEmitter(const glm::vec3& origin, float rate);
+	Emitter& getEmitter(int index) {return emitters[index];};
+	int getNEmitters() const {return static_cast<int>(emitters.size());};
+	void burst(int emitter, int nParticles) {emitters[emitter].burst += nParticles;};
+
+	const ParticleStore& getParticles() const {return particles;};
+	/* Bounds of the live particles' positions at the last update or
+	 * reset, or empty at the origin if there are none. */
+	void getBounds(glm::vec3& min, glm::vec3& max) const
+		{min = minPos; max = maxPos;};
+
+	glm::vec4 extForce; //External force applied to all particles.
+	const ForceField* field; //Force varying over space, or null. Not owned.
+
+	float height;
+
+	int avgLifetime;
+	int varLifetime;
+	glm::vec4 initAcn;
+	float initVel;
+	float initUpVel;
+	int avgPerturbTime;
+	int varPerturbTime;
+	float perturbRadius;
+	float baseRadius;
+	float centerForce;
+	bool perturbOn;
+	bool initPerturb; //Perturb particles' velocities at reset().
+	int maxSubsteps; //Steps advance() may run per call.
+	bool respawn; //Respawn dead particles, rather than removing them.
+protected:
+	ParticleStore particles;
+	int randi(int low, int high);
+	float randf(float low, float high);
+private:
+	glm::vec3 minPos;
+	glm::vec3 maxPos;
+	void updateBounds();
+
+	float stepRate;
+	float stepTime;    //ms per step.
+	float accumulator; //ms not yet simulated.
+	float timerCarry;  //Fraction of a ms not yet added to the clock.
+	int clock;         //ms simulated since construction.
+	float getStepTime() const;
+	void step(int dTime, float dt, int nThreads, float* view, float alpha);
+	void interpolate(float* view, float alpha, int nThreads);
+
+	TimingWheel events;
+	std::vector<TimingWheel::Event> dueEvents;
+	std::vector<unsigned> dueMask; //Bit per particle with an event due.
+	void schedule(int index);
+	int nextEvent(int index) const;
+	void handleEvents(const ParticleKernel::Params& params);
+	void kill(int index, const ParticleKernel::Params& params);
+
+	std::vector<Emitter> emitters;
+	void emit(float dt, const ParticleKernel::Params& params);
+
+	float lod;
+	float lodPending; //Fraction of a particle due to refill the pool.
+	void applyLOD(float dt, const ParticleKernel::Params& params);
+
+	glm::vec4 getInitVel(const glm::vec4& pos);
+	glm::vec4 perturb(glm::vec4 input);
+	glm::vec4 randInitPos();
+};
+
+#endif
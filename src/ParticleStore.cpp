@@ -0,0 +1,73 @@
+#include "ParticleStore.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+namespace
+{
+	const int nViewStreams = 5;
+	const int nFloatStreams = 14;
+	const int nIntStreams = 4;
+	const size_t streamAlign = 32;
+}
+
+ParticleStore::ParticleStore(int size)
+	:size(size),
+	 paddedSize(((size + simdWidth - 1) / simdWidth) * simdWidth),
+	 nLive(size)
+{
+	/* All streams share one block, each padded to a whole number of
+	 * SIMD registers, so every stream is aligned if the first is. */
+	const size_t streamBytes = paddedSize * sizeof(float);
+	const size_t blockBytes = (nFloatStreams + nIntStreams) * streamBytes;
+	block = new char[blockBytes + streamAlign];
+	char* s = block + (streamAlign - reinterpret_cast<uintptr_t>(block) % streamAlign);
+	streams = reinterpret_cast<float*>(s);
+	memset(s, 0, blockBytes);
+
+	float** floatStreams[nFloatStreams] =
+		{&px, &py, &pz, &decay, &randTex, &vx, &vy, &vz,
+		 &prevX, &prevY, &prevZ, &originX, &originY, &originZ};
+	for(int i = 0; i < nFloatStreams; ++i, s += streamBytes)
+		*floatStreams[i] = reinterpret_cast<float*>(s);
+
+	int** intStreams[nIntStreams - 1] = {&birth, &lifeTime, &perturbAt};
+	for(int i = 0; i < nIntStreams - 1; ++i, s += streamBytes)
+		*intStreams[i] = reinterpret_cast<int*>(s);
+
+	/* Distinct, non-zero seeds, padding included. */
+	seed = reinterpret_cast<unsigned*>(s);
+	for(int i = 0; i < paddedSize; ++i)
+		seed[i] = 2654435761u * static_cast<unsigned>(i + 1);
+}
+
+ParticleStore::~ParticleStore()
+{
+	delete[] block;
+}
+
+int ParticleStore::add(int n)
+{
+	n = std::max(0, std::min(n, size - nLive));
+	nLive += n;
+	return n;
+}
+
+void ParticleStore::remove(int index)
+{
+	const int last = --nLive;
+	if(index == last) return;
+
+	// Every stream is 4 byte values, paddedSize apart, seed last.
+	for(int s = 0; s < nFloatStreams + nIntStreams - 1; ++s)
+		streams[s * paddedSize + index] = streams[s * paddedSize + last];
+
+	/* Swap seeds rather than copy, so no two particles share one. */
+	std::swap(seed[index], seed[last]);
+}
+
+size_t ParticleStore::getViewBytes() const
+{
+	return nViewStreams * paddedSize * sizeof(float);
+}
@@ -0,0 +1,89 @@
+#ifndef PARTICLESTORE_HPP
+#define PARTICLESTORE_HPP
+
+#include <glm.hpp>
+
+#include <cstddef>
+
+/* ParticleStore
+ * Structure-of-arrays storage for a pool of up to size particles.
+ * Each attribute is its own stream, starting on a 32 byte boundary
+ *   and padded to a multiple of simdWidth entries, so loops may
+ *   process particles a full SIMD register at a time without a
+ *   scalar tail. Positions are implicitly w = 1 and velocities w = 0.
+ * Live particles are kept packed at the front of the streams, so
+ *   loops and draws need only cover the first getNLive(). add()
+ *   appends particles, and remove() fills the hole it leaves with the
+ *   last live particle, so indices are only stable until a remove().
+ *   A new store has every particle live.
+ * The streams read by the particle shaders (px, py, pz, decay and
+ *   randTex) are adjacent, and form the GPU view, which may be copied
+ *   to a VBO in one block. The store itself makes no GL calls.
+ */
+class ParticleStore
+{
+public:
+	static const int simdWidth = 8;
+
+	ParticleStore(int size);
+	~ParticleStore();
+
+	int getSize() const {return size;};
+	int getPaddedSize() const {return paddedSize;};
+
+	/* Makes up to n more particles live, as many as there is room for,
+	 * returning the number added. They start at index getNLive(), and
+	 * must be initialised by the caller. */
+	int add(int n);
+	void remove(int index);
+	void clear() {nLive = 0;};
+	/* Removes every particle from index n on. */
+	void truncate(int n) {if(n < nLive) nLive = n > 0 ? n : 0;};
+	int getNLive() const {return nLive;};
+	/* getNLive() rounded up to a whole number of SIMD registers. */
+	int getPaddedNLive() const
+		{return ((nLive + simdWidth - 1) / simdWidth) * simdWidth;};
+
+	glm::vec4 getPos(int index) const
+		{return glm::vec4(px[index], py[index], pz[index], 1.0f);};
+	void setPos(int index, const glm::vec4& p)
+		{px[index] = p.x; py[index] = p.y; pz[index] = p.z;};
+	glm::vec4 getVel(int index) const
+		{return glm::vec4(vx[index], vy[index], vz[index], 0.0f);};
+	void setVel(int index, const glm::vec4& v)
+		{vx[index] = v.x; vy[index] = v.y; vz[index] = v.z;};
+
+	/* GPU view */
+	const void* getViewData() const {return px;};
+	size_t getViewBytes() const;
+
+	/* Float streams. The first five are the GPU view. */
+	float* px; float* py; float* pz;
+	float* decay;
+	float* randTex;
+	float* vx; float* vy; float* vz;
+	/* Positions at the start of the last step, for interpolation. */
+	float* prevX; float* prevY; float* prevZ;
+	/* The point each particle was emitted about, which it respawns
+	 * about and is pulled back towards. */
+	float* originX; float* originY; float* originZ;
+
+	/* Integer streams, in ms. Times are on the owner's clock. */
+	int* birth;
+	int* lifeTime;
+	int* perturbAt; //Time of the next perturbation.
+
+	/* Per-particle random number generator states, never 0. */
+	unsigned* seed;
+private:
+	ParticleStore(const ParticleStore&);
+	ParticleStore& operator=(const ParticleStore&);
+
+	const int size;
+	const int paddedSize;
+	char* block;
+	float* streams; //block, aligned.
+	int nLive;
+};
+
+#endif
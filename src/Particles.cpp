@@ -4,6 +4,9 @@
 #include "Scene.hpp"
 #include "SphereFunc.hpp"
 #include "Shader.hpp"
+#include "StreamBuffer.hpp"
+#include "DepthSort.hpp"
+#include "Camera.hpp"
 
 #include <SOIL.h>
 #include <GL/glut.h>
@@ -11,6 +14,8 @@
 #include <gtc/matrix_transform.hpp>
 
 #include<algorithm>
+#include <cmath>
+#include <cstdint>
 
 const float AdvectParticlesLights::minColor = 0.6f;
 const float AdvectParticlesSHLights::minColor = 0.7f;
@@ -21,80 +26,64 @@ AdvectParticles::AdvectParticles(int maxParticles,
 	ParticleShader* shader, 
 	Texture* bbTex, Texture* decayTex, bool texScrolls, bool additive)
 	:ParticleSystem(maxParticles, shader),
+	 ParticleSim(maxParticles),
 	 bbTex(bbTex), decayTex(decayTex),
-	 avgLifetime(3000), varLifetime(200),
-	 avgPerturbTime(1000), varPerturbTime(100),
-	 initAcn(glm::vec4(0.0, 0.0000004, 0.0, 0.0)),
-	 initVel(0.001f),
-	 initUpVel(0.0f),
-	 perturbRadius(0.0001f),
-	 centerForce(6e-7f),
-	 baseRadius(0.2f),
-	 bbHeight(0.3f), bbWidth(0.3f),
-	 extForce(glm::vec4(0.0f)),
-	 perturbOn(true), initPerturb(false),
+	 bbHeight(0.3f), bbWidth(0.3f), lodOn(true), bbScale(1.0f),
 	 cameraDir(glm::vec3(0.0, 0.0, -1.0)),
-	 additive(additive), height(initAcn.y * avgLifetime)
+	 additive(additive)
 {init(bbTex, decayTex, texScrolls);}
 
-void AdvectParticles::init(Texture* bbTex, Texture* decayTex, bool texScrolls)
+AdvectParticles::~AdvectParticles()
 {
-	shader->use();
+	delete stream;
+	delete indexStream;
+	delete depthSort;
+}
 
-	// Set up particles.
-	for(int i = 0; i < maxParticles; ++i)
-	{
-		AdvectParticle p;
-		p.pos = randInitPos();
-		p.decay = 0.0f;
-		p.randTex = randf(0.0f, 1.0f);
-		particles.push_back(p);
-
-		time.push_back(0);
-		// Evenly spacing lifetimes so system stabilises quicly.
-		lifeTime.push_back((avgLifetime * i) / maxParticles);
-		acn.push_back(initAcn);
-		
-		perturbCounter.push_back(0);
-		perturbTime.push_back(avgPerturbTime + randi(-varPerturbTime, varPerturbTime)); 
-
-		if(initPerturb) vel.push_back(perturb(getInitVel(p.pos)));
-		else vel.push_back(getInitVel(p.pos));
-	}
+void AdvectParticles::init(Texture* bbTex, Texture* decayTex, bool texScrolls)
+{
+	updateBounds();
+	drawBounds = bounds;
 
-	glUseProgram(0);
+	// Seeded per system, so systems pick different clumps.
+	randSeed = static_cast<unsigned>(reinterpret_cast<uintptr_t>(this)) * 2654435761u;
+	if(randSeed == 0) randSeed = 1;
 
 	shader->setAlpha(alpha);
 	shader->setBBTexUnit(bbTex->getTexUnit());
 	shader->setDecayTexUnit(decayTex->getTexUnit());
 
 	// Set up vertex buffer objects.
-	glGenBuffers(1, &particles_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, particles_vbo);
-	glBufferData(GL_ARRAY_BUFFER, particles.size()*sizeof(AdvectParticle),
-		particles.data(), GL_DYNAMIC_DRAW);
+	stream = new StreamBuffer(particles.getViewBytes(), particles.getViewData());
+	viewWritten = false;
+	drawCount = particles.getNLive();
+
+	if(additive)
+	{
+		depthSort = nullptr;
+		indexStream = nullptr;
+	}
+	else
+	{
+		depthSort = new DepthSort(particles.getSize());
+		indexStream = new StreamBuffer(particles.getSize() * sizeof(unsigned),
+			depthSort->getOrder());
+	}
+	depthAxis = glm::vec3(0.0f, 0.0f, 1.0f);
 
 	// Set up uniforms.
 	shader->setBBWidth(bbWidth);
 	shader->setBBHeight(bbHeight);
 
-	pos_attrib = shader->getAttribLoc("vPos");
-	decay_attrib = shader->getAttribLoc("vDecay");
-	if(texScrolls) randTex_attrib = shader->getAttribLoc("vRandTex");
+	this->texScrolls = texScrolls;
 
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao);
 
-	glBindBuffer(GL_ARRAY_BUFFER, particles_vbo);
-	glEnableVertexAttribArray(pos_attrib);
-	glEnableVertexAttribArray(decay_attrib);
-	glEnableVertexAttribArray(randTex_attrib);
-	glVertexAttribPointer(pos_attrib, 4, GL_FLOAT, GL_FALSE, sizeof(AdvectParticle),
-		reinterpret_cast<GLvoid*>(offsetof(AdvectParticle, pos)));
-	glVertexAttribPointer(decay_attrib, 1, GL_FLOAT, GL_FALSE, sizeof(AdvectParticle), 
-		reinterpret_cast<GLvoid*>(offsetof(AdvectParticle, decay)));
-	glVertexAttribPointer(randTex_attrib, 1, GL_FLOAT, GL_FALSE, sizeof(AdvectParticle), 
-		reinterpret_cast<GLvoid*>(offsetof(AdvectParticle, randTex)));
+	glBindBuffer(GL_ARRAY_BUFFER, stream->getBuffer());
+	attachParticles(shader, texScrolls);
+	if(indexStream)
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexStream->getBuffer());
 
 	glBindVertexArray(0);
 }
@@ -113,24 +102,21 @@ void AdvectParticles::render()
 	shader->setAlpha(alpha);
 	shader->setBBTexUnit(bbTex->getTexUnit());
 	shader->setDecayTexUnit(decayTex->getTexUnit());
-	shader->setBBHeight(bbHeight);
-	shader->setBBWidth(bbWidth);
+	shader->setBBHeight(bbHeight * bbScale);
+	shader->setBBWidth(bbWidth * bbScale);
 
 	shader->use();
 
-	glBindBuffer(GL_ARRAY_BUFFER, particles_vbo);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, particles.size()*sizeof(AdvectParticle),
-		particles.data());
-
 	glBindVertexArray(vao);
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	
-	glDrawArrays(GL_POINTS, 0, particles.size());
+	if(indexStream)
+		glDrawElementsBaseVertex(GL_POINTS, drawCount, GL_UNSIGNED_INT,
+			reinterpret_cast<const GLvoid*>(indexStream->getDrawOffset()), getDrawFirst());
+	else
+		glDrawArrays(GL_POINTS, getDrawFirst(), drawCount);
 
 	glBindVertexArray(0);
 
-	glUseProgram(0);
 	glDisable(GL_BLEND);
 	glDepthMask(GL_TRUE);
 }
@@ -142,113 +128,114 @@ void AdvectParticles::setShader(ParticleShader* shader)
 	shader->setBBTexUnit(bbTex->getTexUnit());
 	shader->setDecayTexUnit(decayTex->getTexUnit());
 
-	// Set up vertex buffer objects.
-	glGenBuffers(1, &particles_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, particles_vbo);
-	glBufferData(GL_ARRAY_BUFFER, particles.size()*sizeof(AdvectParticle),
-		particles.data(), GL_DYNAMIC_DRAW);
-
 	// Set up uniforms.
 	shader->setBBWidth(bbWidth);
 	shader->setBBHeight(bbHeight);
 
-	pos_attrib = shader->getAttribLoc("vPos");
-	decay_attrib = shader->getAttribLoc("vDecay");
-
 	glBindVertexArray(vao);
 
-	glBindBuffer(GL_ARRAY_BUFFER, particles_vbo);
-	glEnableVertexAttribArray(pos_attrib);
-	glEnableVertexAttribArray(decay_attrib);
-	glEnableVertexAttribArray(randTex_attrib);
-	glVertexAttribPointer(pos_attrib, 4, GL_FLOAT, GL_FALSE, sizeof(AdvectParticle),
-		reinterpret_cast<GLvoid*>(offsetof(AdvectParticle, pos)));
-	glVertexAttribPointer(decay_attrib, 1, GL_FLOAT, GL_FALSE, sizeof(AdvectParticle), 
-		reinterpret_cast<GLvoid*>(offsetof(AdvectParticle, decay)));
-	glVertexAttribPointer(randTex_attrib, 1, GL_FLOAT, GL_FALSE, sizeof(AdvectParticle), 
-		reinterpret_cast<GLvoid*>(offsetof(AdvectParticle, randTex)));
+	glBindBuffer(GL_ARRAY_BUFFER, stream->getBuffer());
+	attachParticles(shader, texScrolls);
 
 	glBindVertexArray(0);
 }
 
 void AdvectParticles::update(int dTime)
 {
-	if(dTime > 1000) return; // Avoid updating if timestep excessive
-	#pragma omp parallel for
-	for(int i = 0; i < maxParticles; ++i)
-		updateParticle(i, dTime);
+	// Write the particles straight into the stream buffer.
+	ParticleSim::advance(dTime, updateThreads,
+		static_cast<float*>(stream->getWriteRegion()));
+	if(depthSort)
+		depthSort->sort(particles, depthAxis, updateThreads,
+			static_cast<unsigned*>(indexStream->getWriteRegion()));
+	viewWritten = true;
+	updateBounds();
 }
 
-void AdvectParticles::updateParticle(int index, int dTime)
+void AdvectParticles::postUpdate()
 {
-	time[index] += dTime;
-	if(time[index] > lifeTime[index]) spawnParticle(index);
-	particles[index].decay = ((float) time[index]) / ((float) lifeTime[index]);
-	perturbCounter[index] += dTime;
+	// Publish the particles simulated by update() for render().
+	stream->commit(viewWritten ? 0 : particles.getViewData());
+	if(indexStream)
+		indexStream->commit(viewWritten ? 0 : depthSort->getOrder());
+	viewWritten = false;
 
-	if(perturbCounter[index] >= perturbTime[index] && perturbOn)
+	if(depthSort && scene)
 	{
-		perturbCounter[index] = 0;
-		perturbTime[index] = avgPerturbTime + randi(-varPerturbTime, varPerturbTime);
-		vel[index] = perturb(vel[index]);
+		/* Row 2 of model to view: view space z, most negative farthest
+		 * away. The camera only moves on this thread, so read it here. */
+		const glm::mat4 modelToView = scene->camera->getWorldToView() * modelToWorld;
+		depthAxis = glm::vec3(modelToView[0][2], modelToView[1][2], modelToView[2][2]);
 	}
 
-	vel[index] += static_cast<float>(dTime) *
-		(acn[index] + (glm::vec4(
-			-particles[index].pos.x,
-			0.0,
-			-particles[index].pos.z,
-			0.0)
-			* centerForce));
+	drawCount = particles.getNLive();
+	drawBounds = bounds;
+	bbScale = 1.0f / std::sqrt(getLOD());
 
-	vel[index] += static_cast<float>(dTime) * extForce;
-	particles[index].pos += (float) dTime * vel[index];
+	if(lodOn && scene)
+	{
+		BoundingVolume world = drawBounds.transformed(modelToWorld);
+		setLOD(scene->camera->screenSize(world.centre, world.radius) /
+			GC::particleFullDetailSize);
+	}
+	else setLOD(1.0f);
 }
 
-void AdvectParticles::spawnParticle(int index)
+void AdvectParticles::updateBounds()
 {
-	time[index] = 0;
-	lifeTime[index] = avgLifetime + randi(-varLifetime, +varLifetime);
-	perturbCounter[index] = 0;
-	perturbTime[index] = avgPerturbTime + randi(-varPerturbTime, varPerturbTime);
-	particles[index].decay = 0.0;
-	acn[index] = initAcn;
-	particles[index].pos = randInitPos();
-	vel[index] = getInitVel(particles[index].pos);
-	particles[index].randTex = randf(0.0f, 1.0f);
+	glm::vec3 minP, maxP;
+	getBounds(minP, maxP);
+
+	/* Billboards may extend half their size in any direction. */
+	glm::vec3 margin(0.5f * bbScale * std::max(bbWidth, bbHeight));
+	bounds = BoundingVolume::fromBox(minP - margin, maxP + margin);
 }
 
-glm::vec4 AdvectParticles::randInitPos()
+GLint AdvectParticles::getDrawFirst() const
 {
-	float theta = randf(0.0f, 2.0f * PI);
-	float radius = randf(0.0f, baseRadius);
-	return glm::vec4(radius*cos(theta), 0.0, radius*sin(theta), 1.0);
+	/* Every attribute is a tightly packed float, so offsetting the
+	 * first vertex by n offsets each attribute by 4n bytes. */
+	return static_cast<GLint>(stream->getDrawOffset() / sizeof(float));
 }
 
-glm::vec4 AdvectParticles::perturb(glm::vec4 input)
+int AdvectParticles::randLiveIndex()
 {
-	float theta = randf(0.0f, 2.0f * PI);
-	float radius = randf(0.0f, perturbRadius);
-	return input + glm::vec4(radius * cos(theta), 0.0, radius * sin(theta), 0.0);
+	randSeed ^= randSeed << 13;
+	randSeed ^= randSeed >> 17;
+	randSeed ^= randSeed << 5;
+	const int nLive = particles.getNLive();
+	return nLive > 0 ? static_cast<int>(randSeed % static_cast<unsigned>(nLive)) : 0;
 }
 
-glm::vec4 AdvectParticles::getInitVel(const glm::vec4& pos)
+void AdvectParticles::refreshClump(std::vector<int>& clump)
 {
-	return glm::vec4(pos.x, pos.y, pos.z, 0.0f) * initVel +
-		glm::vec4(0.0f, 1.0f, 0.0f, 0.0f) * initUpVel;
+	const int nLive = particles.getNLive();
+	for(auto i = clump.begin(); i != clump.end(); ++i)
+		if(*i >= nLive) *i = randLiveIndex();
+}
 
+void AdvectParticles::attachParticles(Shader* shader, bool randTex)
+{
+	attachStream(shader->getAttribLoc("vPosX"), particles.px);
+	attachStream(shader->getAttribLoc("vPosY"), particles.py);
+	attachStream(shader->getAttribLoc("vPosZ"), particles.pz);
+	attachStream(shader->getAttribLoc("vDecay"), particles.decay);
+	if(randTex) attachStream(shader->getAttribLoc("vRandTex"), particles.randTex);
 }
 
-float AdvectParticles::randf(float low, float high)
+void AdvectParticles::attachStream(GLint attrib, const float* values)
 {
-	float r = (float) rand() / (float) RAND_MAX;
-	return low + ((high - low) * r);
+	// Offsets are relative to the start of the view.
+	const char* view = static_cast<const char*>(particles.getViewData());
+	glEnableVertexAttribArray(attrib);
+	glVertexAttribPointer(attrib, 1, GL_FLOAT, GL_FALSE, 0,
+		reinterpret_cast<GLvoid*>(reinterpret_cast<const char*>(values) - view));
 }
 
-int AdvectParticles::randi(int low, int high)
+bool AdvectParticles::getWorldBounds(BoundingVolume& worldBounds)
 {
-	int r = rand() % (high - low);
-	return r + low;
+	worldBounds = drawBounds.transformed(modelToWorld);
+	return true;
 }
 
 std::vector<glm::vec4> AdvectParticles::loadImage(const std::string& filename)
@@ -325,7 +312,7 @@ void AdvectParticlesLights::onRemove()
 void AdvectParticlesLights::update(int dTime)
 {
 	AdvectParticles::update(dTime);
-	updateLights();
+	updateLights(dTime);
 }
 
 void AdvectParticlesLights::setLightIntensity(float lightIntensity)
@@ -367,7 +354,7 @@ void AdvectParticlesCentroidLights::init()
 	{
 		std::vector<int> clump;
 		for(int j = 0; j < clumpSize; ++j)
-			clump.push_back(randi(0, maxParticles));
+			clump.push_back(randLiveIndex());
 		clumps.push_back(clump);
 	}
 }
@@ -376,16 +363,16 @@ void AdvectParticlesCentroidLights::randomizeClumps()
 {
 	for(auto i = clumps.begin(); i != clumps.end(); ++i)
 		for(auto j = i->begin(); j != i->end(); ++j)
-			(*j) = randi(0, maxParticles);
+			(*j) = randLiveIndex();
 }
 
-void AdvectParticlesCentroidLights::updateLights()
+void AdvectParticlesCentroidLights::updateLights(int dTime)
 {
 	if(interval == 0)
 		randomizeClumps();
 	else if(interval > 0)
 	{
-		counter += glutGet(GLUT_ELAPSED_TIME);
+		counter += dTime;
 		if(counter > interval)
 		{
 			randomizeClumps();
@@ -393,8 +380,12 @@ void AdvectParticlesCentroidLights::updateLights()
 		}
 	}
 
+	// Lights keep their last placing while no particles are live.
+	if(particles.getNLive() == 0) return;
+
 	for(int i = 0; i < nLights; ++i)
 	{
+		refreshClump(clumps[i]);
 		lights[i]->setPos(modelToWorld * getParticleCentroid(clumps[i]));
 		lights[i]->setColor(getAverageColor(clumps[i]));
 	}
@@ -405,7 +396,7 @@ glm::vec4 AdvectParticlesCentroidLights::getParticleCentroid(
 {
 	glm::vec4 sum;
 	for(auto i = clump.begin(); i != clump.end(); ++i)
-		sum += particles[*i].pos;
+		sum += particles.getPos(*i);
 	return sum / static_cast<float>(clump.size());
 }
 
@@ -414,7 +405,7 @@ glm::vec4 AdvectParticlesCentroidLights::getAverageColor(
 {
 	glm::vec4 color;
 	for(auto i = clump.begin(); i != clump.end(); ++i)
-		color += getParticleColor(particles[*i].decay);
+		color += getParticleColor(particles.decay[*i]);
 	return color / static_cast<float>(clump.size());
 }
 
@@ -473,7 +464,12 @@ void AdvectParticlesSHLights::onRemove()
 void AdvectParticlesSHLights::update(int dTime)
 {
 	AdvectParticles::update(dTime);
-	updateLights();
+	updateLights(dTime);
+}
+
+void AdvectParticlesSHLights::getUpdateDeps(std::vector<Renderable*>& deps)
+{
+	if(targetObj) deps.push_back(targetObj);
 }
 
 void AdvectParticlesSHLights::setIntensity(float intensity)
@@ -513,7 +509,7 @@ void AdvectParticlesCentroidSHLights::init()
 	{
 		std::vector<int> clump;
 		for(int j = 0; j < clumpSize; ++j)
-			clump.push_back(randi(0, maxParticles));
+			clump.push_back(randLiveIndex());
 		clumps.push_back(clump);
 	}
 }
@@ -522,16 +518,16 @@ void AdvectParticlesCentroidSHLights::randomizeClumps()
 {
 	for(auto i = clumps.begin(); i != clumps.end(); ++i)
 		for(auto j = i->begin(); j != i->end(); ++j)
-			(*j) = randi(0, maxParticles);
+			(*j) = randLiveIndex();
 }
 
-void AdvectParticlesCentroidSHLights::updateLights()
+void AdvectParticlesCentroidSHLights::updateLights(int dTime)
 {
 	if(interval == 0)
 		randomizeClumps();
 	else if(interval > 0)
 	{
-		counter += glutGet(GLUT_ELAPSED_TIME);
+		counter += dTime;
 		if(counter > interval)
 		{
 			randomizeClumps();
@@ -539,10 +535,14 @@ void AdvectParticlesCentroidSHLights::updateLights()
 		}
 	}
 
+	// Lights keep their last placing while no particles are live.
+	if(particles.getNLive() == 0) return;
+
 	glm::mat4 toTarget = glm::inverse(targetObj->getModelToWorld()) * modelToWorld;
 
 	for(int i = 0; i < nLights; ++i)
 	{
+		refreshClump(clumps[i]);
 		lights[i]->pointAt(glm::vec3(toTarget * getParticleCentroid(clumps[i])));
 		lights[i]->setColor(getAverageColor(clumps[i]));
 	}
@@ -553,7 +553,7 @@ glm::vec4 AdvectParticlesCentroidSHLights::getParticleCentroid(
 {
 	glm::vec4 sum;
 	for(auto i = clump.begin(); i != clump.end(); ++i)
-		sum += particles[*i].pos;
+		sum += particles.getPos(*i);
 	return sum / (float) clump.size();
 }
 
@@ -562,7 +562,7 @@ glm::vec3 AdvectParticlesCentroidSHLights::getAverageColor(
 {
 	glm::vec3 color;
 	for(auto i = clump.begin(); i != clump.end(); ++i)
-		color += getParticleColor(particles[*i].decay);
+		color += getParticleColor(particles.decay[*i]);
 	return color / static_cast<float>(clump.size());
 }
 
@@ -579,8 +579,18 @@ AdvectParticlesSHCubemap::AdvectParticlesSHCubemap(
 void AdvectParticlesSHCubemap::update(int dTime)
 {
 	AdvectParticles::update(dTime);
+	updateLight(); //Projects the cubemap read back by the last postUpdate().
+}
+
+void AdvectParticlesSHCubemap::postUpdate()
+{
+	AdvectParticles::postUpdate();
 	renderCubemap();
-	updateLight();
+}
+
+void AdvectParticlesSHCubemap::getUpdateDeps(std::vector<Renderable*>& deps)
+{
+	if(targetObj) deps.push_back(targetObj);
 }
 
 void AdvectParticlesSHCubemap::onAdd()
@@ -630,19 +640,11 @@ void AdvectParticlesSHCubemap::init()
 	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA, GC::cubemapSize, GC::cubemapSize);
 	glBindRenderbuffer(GL_RENDERBUFFER, 0);
 
-	cube_pos_attrib = cubemapShader->getAttribLoc("vPos");
-	cube_decay_attrib = cubemapShader->getAttribLoc("vDecay");
-
 	glGenVertexArrays(1, &cube_vao);
 	glBindVertexArray(cube_vao);
 
-	glBindBuffer(GL_ARRAY_BUFFER, particles_vbo);
-	glEnableVertexAttribArray(cube_pos_attrib);
-	glEnableVertexAttribArray(cube_decay_attrib);
-	glVertexAttribPointer(cube_pos_attrib, 4, GL_FLOAT, GL_FALSE, sizeof(AdvectParticle),
-		reinterpret_cast<GLvoid*>(offsetof(AdvectParticle, pos)));
-	glVertexAttribPointer(cube_decay_attrib, 1, GL_FLOAT, GL_FALSE, sizeof(AdvectParticle), 
-		reinterpret_cast<GLvoid*>(offsetof(AdvectParticle, decay)));
+	glBindBuffer(GL_ARRAY_BUFFER, stream->getBuffer());
+	attachParticles(cubemapShader, false);
 
 	glBindVertexArray(0);
 
@@ -680,8 +682,9 @@ void AdvectParticlesSHCubemap::renderCubemap()
 	cubemapShader->setModelToWorld(modelToWorld);
 	cubemapShader->setBBTexUnit(bbTex->getTexUnit());
 	cubemapShader->setDecayTexUnit(decayTex->getTexUnit());
-	cubemapShader->setBBWidth(bbWidth);
-	cubemapShader->setBBHeight(bbHeight);
+	// Scaled as in render(), so the light does not dim with the LOD.
+	cubemapShader->setBBWidth(bbWidth * bbScale);
+	cubemapShader->setBBHeight(bbHeight * bbScale);
 	glm::mat4 worldToObject = glm::inverse(
 		targetObj->getTranslation() * targetObj->getRotation());
 	cubemapShader->setWorldToObject(worldToObject);
@@ -697,7 +700,7 @@ void AdvectParticlesSHCubemap::renderCubemap()
 
 		glClear(GL_COLOR_BUFFER_BIT);
 
-		glDrawArrays(GL_POINTS, 0, particles.size());
+		glDrawArrays(GL_POINTS, getDrawFirst(), drawCount);
 
 		glPixelStorei(GL_PACK_ALIGNMENT, 1);
 		glReadPixels(0, 0, GC::cubemapSize, GC::cubemapSize, 
@@ -747,7 +750,7 @@ void AdvectParticlesSHCubemap::renderCubemap()
 	else glDisable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, blendFn);
 
-	glUseProgram(0);
+	Shader::unbind();
 }
 
 void AdvectParticlesSHCubemap::updateLight()
@@ -3,6 +3,7 @@
 
 #include "Renderable.hpp"
 #include "Shader.hpp"
+#include "ParticleSim.hpp"
 #include "GC.hpp"
 
 #include <GL/glew.h>
@@ -15,6 +16,8 @@ class Texture;
 class PhongLight;
 class SHLight;
 class ParticleShader;
+class StreamBuffer;
+class DepthSort;
 
 /* ParticleSystem
  * An ADT for a renderable object which is a particle system.
@@ -33,14 +36,6 @@ protected:
 	ParticleShader* shader;
 };
 
-struct AdvectParticle
-{
-	glm::vec4 pos;
-	GLfloat decay;
-	GLfloat randTex;
-};
-
-
 /* AdvectParticles
  * A ParticleSystem consisting of MaxParticles particles, which behave as follows:
  * #1: Particles spawn at a random point in a disk of radius baseRadius, around (0,0,0) in model space.
@@ -49,77 +44,89 @@ struct AdvectParticle
  *  	In this case, the particle is given a random force in the disk of radius perturbRadius in the x-z plane.
  * #4: A centering force of magnitude centerForce pulls the particles towards the y-axis in model space at all times.
  * #5: Particles live for a random lifetime in [avgLifetime - varLifetime, avgLifetime + varLifetime] (units ms). 
- * 		Upon death, a new particle is spawned (so MaxParticles particles are present at all times).
+ * 		Upon death, a new particle is spawned (so MaxParticles particles are present at all times),
+ * 		unless respawn is false, when particles instead come from emitters (see ParticleSim).
  * Particles are rendered as billboards of height bbHeight, width bbWidth. 
  * The bbTex is applied to each particle billboard. The colour of the billboard is set by a point along
  *  decayTex determined by the particle's remaining lifetime.
  * **Note** that scrollTexParticles.glsl uses bbTex in a different way. See the shader source for more details.
  * The additive property determines whether additive or subtractive alpha 
- *   blending is used.
+ *   blending is used. Subtractive systems are drawn back to front, in an
+ *   order depth sorted by update() each frame (see DepthSort), along the
+ *   view direction captured at the previous postUpdate().
+ * Particle state is held in a ParticleStore, updated a chunk at a time.
+ *   All particles share the acceleration initAcn + extForce.
+ * update() runs fixed steps, however long the frame (see
+ *   ParticleSim::advance()), and particles are drawn interpolated
+ *   between the last two.
+ * With lodOn, postUpdate() sets the LOD (see ParticleSim::setLOD()) from
+ *   the screen height the system covers, relative to
+ *   GC::particleFullDetailSize, and billboards are drawn larger by the
+ *   inverse square root of the LOD, so fewer particles cover the same
+ *   area.
+ * The simulation itself, and its parameters, are the GL-free
+ *   ParticleSim; this class adds the VBO, VAO and rendering.
  */
-class AdvectParticles : public ParticleSystem
+class AdvectParticles : public ParticleSystem, public ParticleSim
 {
 public:
 	AdvectParticles(int maxParticles, ParticleShader* shader,
 		Texture* bbTex, Texture* decayTex, bool texScrolls = true, bool additive = true);
+	~AdvectParticles();
 
 	void render();
 	virtual void update(int dTime);
+	virtual void postUpdate();
 	virtual void setShader(ParticleShader* shader);
+	GLuint getVAO() {return vao;};
+	const void* getTextureSet() {return bbTex;};
+	bool getWorldBounds(BoundingVolume& worldBounds);
 
-	glm::vec4 extForce; //External force applied to all particles.
-
-	float height;
-
-	int avgLifetime;
-	int varLifetime;
-	glm::vec4 initAcn;
-	float initVel;
-	float initUpVel;
-	int avgPerturbTime;
-	int varPerturbTime;
-	float perturbRadius;
-	float baseRadius;
-	float centerForce;
 	glm::vec3 cameraDir;
 	float bbHeight; //Particle billboard width.
 	float bbWidth;  //Particle billboard height.
+	bool lodOn;
 protected:
 	bool additive;
-	std::vector<AdvectParticle> particles;
-	int randi(int low, int high);
-	float randf(float low, float high);
 
 	std::vector<glm::vec4> loadImage(const std::string& filename);
 	float saturate(float val, float min);
 
 	GLuint vao;
-	GLuint particles_vbo;
-	GLuint pos_attrib;
-	GLuint decay_attrib;
-	GLuint randTex_attrib;
+	/* The GPU view of the particles, which update() writes directly. */
+	StreamBuffer* stream;
+	bool viewWritten;
+	/* Live particles in the stream's draw region. */
+	int drawCount;
+	/* Draw order for subtractive blending, or null if additive. */
+	DepthSort* depthSort;
+	StreamBuffer* indexStream;
+	glm::vec3 depthAxis; //Model space view depth, for the next sort.
+	float bbScale; //Billboard scale for the LOD drawn.
+	bool texScrolls;
 
 	Texture* bbTex;
 	Texture* decayTex;
+	/* First vertex to draw from, as the stream's draw region moves. */
+	GLint getDrawFirst() const;
+	/* Sets up attributes of the bound VAO to read the view from the
+	 * bound GL_ARRAY_BUFFER. */
+	void attachParticles(Shader* shader, bool randTex);
+	/* A random live particle, or 0 if there are none. Draws from
+	 * randSeed, not rand(), as update() may run on any thread. */
+	int randLiveIndex();
+	unsigned randSeed; //xorshift state, never 0.
+	/* Redraws indices no longer live, after the pool shrinks. */
+	void refreshClump(std::vector<int>& clump);
 private:
-	std::vector<glm::vec4> vel;
-	std::vector<glm::vec4> acn;
-
-	std::vector<int> time;
-	std::vector<int> lifeTime;
-	std::vector<int> perturbCounter;
-	std::vector<int> perturbTime;
+	/* Bounds of the particles' billboards, refitted every update,
+	 * and the copy published for render() by postUpdate(). */
+	BoundingVolume bounds;
+	BoundingVolume drawBounds;
+	void updateBounds();
 
-	bool perturbOn;
-	bool initPerturb;
-
-	void updateParticle(int index, int dTime);
-	void spawnParticle(int index);
 	void init(Texture* bbTex, Texture* decayTex, bool texScrolls);
-	glm::vec4 getInitVel(const glm::vec4& pos);
-
-	glm::vec4 perturb(glm::vec4 input);
-	glm::vec4 randInitPos();
+	void attachStream(GLint attrib, const float* values);
 };
 
 /* AdvectParticlesLights
@@ -139,7 +146,8 @@ public:
 	void update(int dTime);
 	void setLightIntensity(float lightIntensity);
 protected:
-	virtual void updateLights() = 0;
+	/* Called from update(), with its dTime. */
+	virtual void updateLights(int dTime) = 0;
 	glm::vec4 getParticleColor(float decay);
 	std::vector<glm::vec4> particleColors;
 private:
@@ -161,7 +169,7 @@ public:
 		Texture* _bbTex, Texture* _decayTex);
 	const int clumpSize;
 protected:
-	void updateLights();
+	void updateLights(int dTime);
 private:
 	int counter;
 	const int interval;
@@ -190,10 +198,12 @@ public:
 	void onAdd();
 	void onRemove();
 	void update(int dTime);
+	void getUpdateDeps(std::vector<Renderable*>& deps);
 	void setIntensity(float intensity);
 	float getIntensity() {return intensity;};
 protected:
-	virtual void updateLights() = 0;
+	/* Called from update(), with its dTime. */
+	virtual void updateLights(int dTime) = 0;
 	void makeLights();
 	Renderable* targetObj;
 	std::vector<glm::vec4> particleColors;
@@ -216,7 +226,7 @@ public:
 		Texture* _bbTex, Texture* _decayTex);
 	const int clumpSize;
 protected:
-	void updateLights();
+	void updateLights(int dTime);
 private:
 	int counter;
 	const int interval;
@@ -239,6 +249,8 @@ public:
 		float intensity,
 		Texture* _bbTex, Texture* _decayTex);
 	void update(int dTime);
+	void postUpdate();
+	void getUpdateDeps(std::vector<Renderable*>& deps);
 	void onAdd();
 	void saveCubemap();
 	void setIntensity(float intensity);
@@ -262,8 +274,6 @@ private:
 	GLuint renderbuffer;
 	GLuint framebuffer;
 	GLuint cube_vao;
-	GLuint cube_pos_attrib;
-	GLuint cube_decay_attrib;
 	bool saveFlag;
 	float intensity;
 	float ambIntensity;
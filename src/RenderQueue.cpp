@@ -0,0 +1,140 @@
+#include "RenderQueue.hpp"
+
+#include "Renderable.hpp"
+#include "Shader.hpp"
+#include "Camera.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	/* The bits of a positive float increase with its value, so
+	 * their top bits make a depth key. Negative depths map to 0. */
+	uint64_t depthBits(float depth)
+	{
+		if(!(depth > 0.0f)) return 0;
+		uint32_t bits;
+		memcpy(&bits, &depth, sizeof(float));
+		return bits;
+	}
+}
+
+RenderQueue::RenderQueue()
+{
+	memset(&stats, 0, sizeof(stats));
+}
+
+void RenderQueue::build(
+	const std::set<Renderable*>& opaque,
+	const std::set<Renderable*>& translucent,
+	Camera* camera)
+{
+	items.clear();
+	items.reserve(opaque.size() + translucent.size());
+	stats.culled = 0;
+
+	for(auto i = opaque.begin(); i != opaque.end(); ++i)
+	{
+		if(culled(*i, camera)) continue;
+		Item item = {makeKey(*i, false, camera), *i};
+		items.push_back(item);
+	}
+	for(auto i = translucent.begin(); i != translucent.end(); ++i)
+	{
+		if(culled(*i, camera)) continue;
+		Item item = {makeKey(*i, true, camera), *i};
+		items.push_back(item);
+	}
+
+	countChanges(stats.unsortedShaderChanges, stats.unsortedTextureChanges, nullptr);
+
+	std::sort(items.begin(), items.end());
+}
+
+void RenderQueue::render()
+{
+	Shader::takeProgramBinds();
+
+	for(auto i = items.begin(); i != items.end(); ++i)
+		i->r->render();
+
+	Shader::unbind();
+
+	stats.drawn = static_cast<int>(items.size());
+	countChanges(stats.shaderChanges, stats.textureChanges, &stats.vaoChanges);
+	stats.programBinds = Shader::takeProgramBinds();
+}
+
+bool RenderQueue::culled(Renderable* r, Camera* camera)
+{
+	BoundingVolume bounds;
+	if(!camera || !r->getWorldBounds(bounds)) return false;
+	if(camera->inFrustum(bounds)) return false;
+
+	++stats.culled;
+	return true;
+}
+
+/* Key layout, from the most significant bit:
+ *   Opaque:      0 | shader (15) | texture set (16) | VAO (16) | depth (16)
+ *   Translucent: 1 | far-to-near depth (31) | shader (16) | texture set (16)
+ */
+uint64_t RenderQueue::makeKey(Renderable* r, bool translucent, Camera* camera)
+{
+	uint64_t shader = shaderIndex(r->getShader());
+	uint64_t texture = textureIndex(r->getTextureSet());
+
+	float depth = 0.0f;
+	if(camera) depth = -(camera->getWorldToView() * r->getOrigin()).z;
+
+	if(!translucent)
+		return 
+			((shader  & 0x7fff) << 48) |
+			((texture & 0xffff) << 32) |
+			((r->getVAO() & 0xffff) << 16) |
+			(depthBits(depth) >> 16);
+
+	uint64_t farFirst = 0x7fffffff - (depthBits(depth) >> 1);
+	return 
+		(uint64_t(1) << 63) |
+		(farFirst << 32) |
+		((shader  & 0xffff) << 16) |
+		(texture & 0xffff);
+}
+
+unsigned RenderQueue::shaderIndex(const void* shader)
+{
+	if(!shader) return 0;
+	auto found = shaderIndices.find(shader);
+	if(found != shaderIndices.end()) return found->second;
+	unsigned index = static_cast<unsigned>(shaderIndices.size()) + 1;
+	shaderIndices[shader] = index;
+	return index;
+}
+
+unsigned RenderQueue::textureIndex(const void* textureSet)
+{
+	if(!textureSet) return 0;
+	auto found = textureIndices.find(textureSet);
+	if(found != textureIndices.end()) return found->second;
+	unsigned index = static_cast<unsigned>(textureIndices.size()) + 1;
+	textureIndices[textureSet] = index;
+	return index;
+}
+
+void RenderQueue::countChanges(int& shaderChanges, int& textureChanges, int* vaoChanges)
+{
+	shaderChanges = textureChanges = 0;
+	if(vaoChanges) *vaoChanges = 0;
+
+	for(size_t i = 0; i < items.size(); ++i)
+	{
+		Renderable* r = items[i].r;
+		Renderable* prev = i > 0 ? items[i-1].r : nullptr;
+
+		if(!prev || prev->getShader() != r->getShader()) ++shaderChanges;
+		if(!prev || prev->getTextureSet() != r->getTextureSet()) ++textureChanges;
+		if(vaoChanges && (!prev || prev->getVAO() != r->getVAO())) ++*vaoChanges;
+	}
+}
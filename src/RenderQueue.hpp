@@ -0,0 +1,70 @@
+#ifndef RENDERQUEUE_HPP
+#define RENDERQUEUE_HPP
+
+#include <GL/glew.h>
+
+#include <set>
+#include <map>
+#include <vector>
+#include <cstdint>
+
+class Renderable;
+class Camera;
+
+struct RenderStats
+{
+	int drawn;           //Renderables drawn.
+	int culled;          //Renderables outside the camera's frustum.
+	int shaderChanges;   //Changes of shader between consecutive draws.
+	int textureChanges;  //Changes of texture set.
+	int vaoChanges;      //Changes of VAO.
+	int unsortedShaderChanges;  //As above, in the unsorted order.
+	int unsortedTextureChanges;
+	int programBinds;    //glUseProgram calls actually made (see Shader::use()).
+};
+
+/* RenderQueue
+ * Orders a frame's renderables by a 64-bit sort key, so that those
+ *   sharing a shader, texture set and VAO are drawn together.
+ * Opaque renderables come first, sorted by shader, texture set, VAO
+ *   then front-to-back depth. Translucent renderables follow, sorted
+ *   back-to-front by depth, then by shader and texture set.
+ * Depth is the view space depth of each renderable's origin.
+ * Renderables with bounds outside the camera's frustum are culled
+ *   while building the queue, so make no GL calls.
+ */
+class RenderQueue
+{
+public:
+	RenderQueue();
+
+	void build(
+		const std::set<Renderable*>& opaque,
+		const std::set<Renderable*>& translucent,
+		Camera* camera);
+	void render();
+
+	/* Stats for the last frame rendered. */
+	const RenderStats& getStats() const {return stats;};
+private:
+	struct Item
+	{
+		uint64_t key;
+		Renderable* r;
+
+		bool operator<(const Item& i) const {return key < i.key;};
+	};
+
+	bool culled(Renderable* r, Camera* camera);
+	uint64_t makeKey(Renderable* r, bool translucent, Camera* camera);
+	unsigned shaderIndex(const void* shader);
+	unsigned textureIndex(const void* textureSet);
+	void countChanges(int& shaderChanges, int& textureChanges, int* vaoChanges);
+
+	std::vector<Item> items;
+	std::map<const void*, unsigned> shaderIndices;
+	std::map<const void*, unsigned> textureIndices;
+	RenderStats stats;
+};
+
+#endif
@@ -4,8 +4,12 @@
 
 #include <gtc/matrix_transform.hpp>
 
+#include <thread>
+#include <algorithm>
+
 Renderable::Renderable(bool _translucent)
 	:scene(nullptr),
+	updateThreads(std::max(1, static_cast<int>(std::thread::hardware_concurrency()))),
 	modelToWorld(glm::mat4(1.0)),
 	translation(glm::mat4(1.0)),
 	rotation(glm::mat4(1.0)),
@@ -2,9 +2,12 @@
 #define RENDERABLE_H
 
 #include "Element.hpp"
+#include "BoundingVolume.hpp"
 
 #include <glm.hpp>
+#include <GL/glew.h>
 #include <exception>
+#include <vector>
 
 class Scene;
 class Shader;
@@ -20,6 +23,16 @@ class BadMaterialIndex : public std::exception {};
  *   false, the Renderable is considered entirely opaque. If
  *   true, some degree of translucency is assumed and the 
  *   alpha blending will be used.
+ * getVAO() and getTextureSet() identify the state render() binds,
+ *   so the Scene's RenderQueue can draw renderables sharing it
+ *   together. Renderables binding no such state may return 0.
+ * getWorldBounds() gives bounds for frustum culling. Renderables
+ *   without bounds return false, and are never culled.
+ * Scene::update() runs updates in parallel (see UpdateGraph), so
+ *   update() must not make GL calls, nor touch other renderables
+ *   except those it adds in getUpdateDeps(), which are updated
+ *   first. GL work belongs in postUpdate(), which is called on the
+ *   GL thread once every update() has finished.
  */
 class Renderable : public Element
 {
@@ -37,11 +50,17 @@ public:
 	void setRotation(const glm::mat4& rotation);
 	glm::vec4 getOrigin(); //Return pos'n of model space origin in world space.
 	virtual void update(int dTime) = 0;
+	virtual void postUpdate() {};
+	virtual void getUpdateDeps(std::vector<Renderable*>& deps) {};
 	virtual void render() = 0;
 	virtual Shader* getShader() = 0;
+	virtual GLuint getVAO() {return 0;};
+	virtual const void* getTextureSet() {return nullptr;};
+	virtual bool getWorldBounds(BoundingVolume& bounds) {return false;};
 	Scene* scene; //Points to scene containing renderable (nullptr if not in scene).
 	virtual void onAdd() {}; //Called when the renderable is added to the scene.
 	virtual void onRemove() {}; //Called when the renderable is removed from the scene.
+	int updateThreads; //Threads update() may use for parallel loops.
 protected:
 	glm::mat4 translation;
 	glm::mat4 rotation;
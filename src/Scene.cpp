@@ -4,6 +4,8 @@
 #include "Camera.hpp"
 #include "GC.hpp"
 #include "SpherePlot.hpp"
+#include "TextureManager.hpp"
+#include "TextureUnits.hpp"
 
 #include <GL/glut.h>
 #include <SOIL.h>
@@ -11,7 +13,8 @@
 #include <vector>
 
 Scene::Scene()
-	 :ambLight(0.1f, 0.1f, 0.1f, 1.0f)
+	 :ambLight(0.1f, 0.1f, 0.1f, 1.0f),
+	 pipelined(GC::pipelineFrames)
 {
 	camera = new Camera();
 
@@ -23,6 +26,8 @@ Scene::Scene()
 
 Scene::~Scene()
 {
+	sync();
+
 	for(auto i = opaque.begin(); i != opaque.end(); ++i)
 	{
 		delete (*i);
@@ -44,35 +49,62 @@ Scene::~Scene()
 
 void Scene::render()
 {
-	//Render opaque renderables first.
-	for(auto i = opaque.begin(); i != opaque.end(); ++i)
-	{
-		(*i)->render();
-	}
-	//Render translucent ones second.
-	for(auto i = translucent.begin(); i != translucent.end(); ++i)
-	{
-		(*i)->render();
-	}
+	TextureUnits::beginFrame();
+
+	//Upload any textures which have finished streaming in.
+	TextureManager::update();
+
+	//Opaque renderables are queued first, translucent ones second.
+	queue.build(opaque, translucent, camera);
+	queue.render();
 }
 
 void Scene::update(int dTime)
 {
-	for(auto i = opaque.begin(); i != opaque.end(); ++i)
+	std::vector<Renderable*> renderables(opaque.begin(), opaque.end());
+	renderables.insert(renderables.end(), translucent.begin(), translucent.end());
+
+	if(!pipelined)
 	{
-		(*i)->update(dTime);
+		//Independent renderables update in parallel, off the GL thread.
+		updateGraph.run(renderables, dTime);
+		publish(renderables);
+		return;
 	}
-	for(auto i = translucent.begin(); i != translucent.end(); ++i)
+
+	//Collect the step simulated during the last render, and start the
+	//next, which runs while the caller renders this one.
+	sync();
+	publish(renderables);
+	updateGraph.start(renderables, dTime);
+}
+
+void Scene::sync()
+{
+	updateGraph.wait();
+}
+
+void Scene::setPipelined(bool pipelined)
+{
+	sync();
+	this->pipelined = pipelined;
+}
+
+void Scene::publish(const std::vector<Renderable*>& renderables)
+{
+	for(auto i = renderables.begin(); i != renderables.end(); ++i)
 	{
-		(*i)->update(dTime);
+		(*i)->postUpdate();
 	}
 
+	phongManager.flush();
 	shManager.update();
 }
 
 Renderable* Scene::add(Renderable* const r)
 {
 	if(r == nullptr) return nullptr;
+	sync();
 	if(r->translucent)
 		translucent.insert(r);
 	else
@@ -86,6 +118,7 @@ Renderable* Scene::add(Renderable* const r)
 
 Renderable* Scene::remove(Renderable* r)
 {
+	sync();
 	if(r->translucent)
 		translucent.erase(r);
 	else
@@ -97,21 +130,25 @@ Renderable* Scene::remove(Renderable* r)
 
 PhongLight* Scene::add(PhongLight* l)
 {
+	sync();
 	return phongManager.add(l);
 }
 
 PhongLight* Scene::remove(PhongLight* l)
 {
+	sync();
 	return phongManager.remove(l);
 }
 
 SHLight* Scene::add(SHLight* l)
 {
+	sync();
 	return shManager.add(l);
 }
 
 SHLight* Scene::remove(SHLight* l)
 {
+	sync();
 	return shManager.remove(l);
 }
 
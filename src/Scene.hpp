@@ -2,10 +2,13 @@
 #define SCENE_HPP
 
 #include "LightManager.hpp"
+#include "RenderQueue.hpp"
+#include "UpdateGraph.hpp"
 
 #include <glm.hpp>
 #include <GL/glew.h>
 #include <set>
+#include <vector>
 
 class PhongLight;
 class SHLight;
@@ -26,10 +29,23 @@ public:
 	~Scene();
 	/* render() renders all renderables added to the scene.
 	 * Opaque objects are rendered first, transparent second.
-	 * Within these categories, renderables are rendered in the order added.
+	 * Renderables are drawn in the order of their RenderQueue sort
+	 * keys, minimising shader and texture changes.
 	 */
 	void render();
+	/* update() updates renderables in parallel where their
+	 * dependencies allow (see UpdateGraph), then calls their
+	 * postUpdate() and uploads changed lights on this thread.
+	 * When pipelined, update() instead publishes the step begun by
+	 * the previous call and starts the next in the background, so
+	 * it is simulated while this frame renders. Renderables and
+	 * their lights must not be modified until the next update() or
+	 * sync(); add() and remove() sync themselves.
+	 */
 	void update(int dTime);
+	void sync();
+	void setPipelined(bool pipelined);
+	bool isPipelined() const {return pipelined;};
 
 	/* add() and remove() functions return a pointer to the element added/removed.
 	 * e.g. Renderable* p = scene.add(new AdvectParticles(s, t1, t2));
@@ -47,6 +63,9 @@ public:
 
 	void setAmbLight(glm::vec4 _ambLight);
 
+	/* State changes made by the last render(). */
+	const RenderStats& getRenderStats() const {return queue.getStats();};
+
 	Camera* camera;
 
 	PhongLightManager phongManager;
@@ -59,6 +78,11 @@ private:
 	std::set<Renderable*> translucent;
 
 	std::set<Shader*> shaders;
+
+	RenderQueue queue;
+	UpdateGraph updateGraph;
+	bool pipelined;
+	void publish(const std::vector<Renderable*>& renderables);
 };
 
 #endif
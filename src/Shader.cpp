@@ -37,6 +37,7 @@ Shader::Shader(bool hasGeomShader, const std::string& filename,
 	id = compileShader(filename, hasGeomShader, true, subs);
 	if(hasModelToWorld) modelToWorld_u = getUniformLoc("modelToWorld");
 	if(hasCamera) setupUniformBlock("cameraBlock");
+	initOptionalUniforms();
 }
 
 Shader::Shader(bool hasGeomShader, const std::string& filename,
@@ -46,23 +47,69 @@ Shader::Shader(bool hasGeomShader, const std::string& filename,
 	id = compileShader(filename, hasGeomShader, true, subs);
 	if(hasModelToWorld) modelToWorld_u = getUniformLoc("modelToWorld");
 	if(hasCamera) setupUniformBlock("cameraBlock");
+	initOptionalUniforms();
 }
 
+void Shader::initOptionalUniforms()
+{
+	/* Optional, so not looked up with getUniformLoc(). */
+	packedVerts_u = glGetUniformLocation(id, "packedVerts");
+	posOffset_u = glGetUniformLocation(id, "posOffset");
+	posScale_u = glGetUniformLocation(id, "posScale");
+	instanced_u = glGetUniformLocation(id, "instanced");
+}
+
+GLuint Shader::current = 0;
+int Shader::programBinds = 0;
+
 Shader::~Shader()
 {
+	if(current == id) current = 0;
 	glDeleteProgram(id);
 }
 
 void Shader::use()
 {
+	if(current == id) return;
 	glUseProgram(id);
+	current = id;
+	++programBinds;
+}
+
+void Shader::unbind()
+{
+	if(current == 0) return;
+	glUseProgram(0);
+	current = 0;
+}
+
+int Shader::takeProgramBinds()
+{
+	int binds = programBinds;
+	programBinds = 0;
+	return binds;
 }
 
 void Shader::setModelToWorld(const glm::mat4& modelToWorld)
 {
 	use();
 	glUniformMatrix4fv(modelToWorld_u, 1, GL_FALSE, &(modelToWorld[0][0]));
-	glUseProgram(0);
+}
+
+void Shader::setPackedVerts(bool packed, const glm::vec3& posOffset, const glm::vec3& posScale)
+{
+	if(packedVerts_u == -1) return;
+	use();
+	glUniform1i(packedVerts_u, packed ? 1 : 0);
+	glUniform3fv(posOffset_u, 1, &(posOffset[0]));
+	glUniform3fv(posScale_u, 1, &(posScale[0]));
+}
+
+void Shader::setInstanced(bool instanced)
+{
+	if(instanced_u == -1) return;
+	use();
+	glUniform1i(instanced_u, instanced ? 1 : 0);
 }
 
 GLuint Shader::loadShader(const std::string& filename,
@@ -193,6 +240,11 @@ GLuint Shader::getAttribLoc(const std::string& name)
 	return loc;
 }
 
+GLint Shader::findAttribLoc(const std::string& name)
+{
+	return glGetAttribLocation(id, name.c_str());
+}
+
 GLuint Shader::getUBlockBindingIndex(const std::string& name)
 {
 	if (name.compare("cameraBlock") == 0) return 0;
@@ -241,36 +293,30 @@ void LightShader::init()
 	diffTex_u = getUniformLoc("diffTex");
 	specTex_u = getUniformLoc("specTex");
 	specExp_u = getUniformLoc("specExp");
-
-	glUseProgram(0);
 }
 
 void LightShader::setAmbTexUnit(GLuint ambTexUnit)
 {
 	use();
 	glUniform1i(ambTex_u, ambTexUnit);
-	glUseProgram(0);
 }
 
 void LightShader::setDiffTexUnit(GLuint diffTexUnit)
 {
 	use();
 	glUniform1i(diffTex_u, diffTexUnit);
-	glUseProgram(0);
 }
 
 void LightShader::setSpecTexUnit(GLuint specTexUnit)
 {
 	use();
 	glUniform1i(specTex_u, specTexUnit);
-	glUseProgram(0);
 }
 
 void LightShader::setSpecExp(float exponent)
 {
 	use();
 	glUniform1f(specExp_u, exponent);
-	glUseProgram(0);
 }
 
 ParticleShader::ParticleShader(bool hasGeomShader, bool hasBBTex, const std::string& filename,
@@ -283,42 +329,36 @@ ParticleShader::ParticleShader(bool hasGeomShader, bool hasBBTex, const std::str
 	bbHeight_u = getUniformLoc("bbHeight");
 	if(hasBBTex) bbTex_u = getUniformLoc("bbTexture");
 	decayTex_u = getUniformLoc("decayTexture");
-	glUseProgram(0);
 }
 
 void ParticleShader::setAlpha(float alpha)
 {
 	use();
 	glUniform1fv(alpha_u, 1, &alpha);
-	glUseProgram(0);
 }
 
 void ParticleShader::setBBWidth(float _bbWidth)
 {
 	use();
 	glUniform1fv(bbWidth_u, 1, &_bbWidth);
-	glUseProgram(0);
 }
 
 void ParticleShader::setBBHeight(float _bbHeight)
 {
 	use();
 	glUniform1fv(bbHeight_u, 1, &_bbHeight);
-	glUseProgram(0);
 }
 
 void ParticleShader::setBBTexUnit(GLuint _bbTexUnit)
 {
 	use();
 	glUniform1i(bbTex_u, _bbTexUnit);
-	glUseProgram(0);
 }
 
 void ParticleShader::setDecayTexUnit(GLuint _decayTexUnit)
 {
 	use();
 	glUniform1i(decayTex_u, _decayTexUnit);
-	glUseProgram(0);
 }
 
 CubemapShader::CubemapShader(
@@ -331,14 +371,12 @@ CubemapShader::CubemapShader(
 	perspective_u = getUniformLoc("perspective");
 	glm::mat4 perspective = glm::perspective(90.0f, 1.0f, 0.01f, 50.0f);
 	glUniformMatrix4fv(perspective_u, 1, GL_FALSE, &(perspective[0][0]));
-	glUseProgram(0);
 }
 
 void CubemapShader::setWorldToObject(const glm::mat4& worldToObject)
 {
 	use();
 	glUniformMatrix4fv(worldToObject_u, 1, GL_FALSE, &(worldToObject[0][0]));
-	glUseProgram(0);
 }
 
 void CubemapShader::setRotation(const glm::mat4& rotation)
@@ -364,7 +402,6 @@ void SHShader::setTexUnit(GLuint unit)
 {
 	use();
 	glUniform1i(texUnit_u, unit);
-	glUseProgram(0);
 }
 
 void SHShader::init()
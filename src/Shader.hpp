@@ -18,6 +18,9 @@ struct Material
 
 /* Shader
  * Handles opening & compiling glsl source from a file, and setting uniforms.
+ * The bound program is tracked, so use() only calls glUseProgram when
+ *   switching programs. Setters leave their shader bound, and all other
+ *   code should unbind with Shader::unbind() rather than glUseProgram(0).
  */
 class Shader
 {
@@ -29,8 +32,23 @@ public:
 		bool hasCamera = true, bool hasModelToWorld = true);
 	virtual ~Shader();
 	void use();
+	static void unbind();
+	/* Returns the glUseProgram calls made since the last call. */
+	static int takeProgramBinds();
 	void setModelToWorld(const glm::mat4& _modelToWorld);
+	/* Sets how the vertex shader decodes packed vertex data
+	 * (see VertexPacking). Ignored by shaders without the
+	 * packedVerts, posOffset and posScale uniforms.
+	 */
+	void setPackedVerts(bool packed, const glm::vec3& posOffset, const glm::vec3& posScale);
+	/* Sets whether the vertex shader applies the per-instance
+	 * vInstance transform (see InstanceBuffer). Ignored by shaders
+	 * without the instanced uniform.
+	 */
+	void setInstanced(bool instanced);
 	GLuint getAttribLoc(const std::string& name);
+	/* As getAttribLoc(), but returns -1 rather than throwing. */
+	GLint findAttribLoc(const std::string& name);
 
 	virtual void setMaterial(unsigned index, const Material& material) {};
 	virtual void setMaterials(const std::vector<Material> _materials) {};
@@ -49,8 +67,15 @@ private:
 	int shaderType, bool DEBUG, std::vector<std::string> subs);
 	GLuint compileShader(const std::string& filename,
 		bool hasGeomShader, bool DEBUG,	std::vector<std::string> subs);
+	void initOptionalUniforms();
+	static GLuint current; //Currently bound program.
+	static int programBinds;
 	GLuint modelToWorld_u;
 	GLuint cameraBlock_i;
+	GLint packedVerts_u;
+	GLint posOffset_u;
+	GLint posScale_u;
+	GLint instanced_u;
 };
 
 /* Error classes for Shader */
@@ -1,6 +1,7 @@
 #include "SpherePlot.hpp"
 
 #include "Shader.hpp"
+#include "Mesh.hpp"
 
 SpherePlotMesh SpherePlot::genMesh(const std::vector<SphereSample>& samples)
 {
@@ -35,7 +36,7 @@ SpherePlotMesh SpherePlot::genMesh(const std::vector<SphereSample>& samples)
 		if(i == sqrtNSamples || j == sqrtNSamples) continue;
 
 		/* Verts at each corner of a quad. */
-		GLushort tlv, trv, blv, brv;
+		GLuint tlv, trv, blv, brv;
 		tlv = i + j*sqrtNSamples;
 		trv = i + 1 + j*sqrtNSamples;
 		blv = i + (j + 1)*sqrtNSamples;
@@ -67,6 +68,11 @@ void SpherePlot::uploadMeshToGPU(const SpherePlotMesh& mesh)
 {
 	numElems = static_cast<GLsizei>(mesh.e.size());
 
+	std::vector<glm::vec4> points;
+	for(auto v = mesh.v.begin(); v != mesh.v.end(); ++v)
+		points.push_back(v->pos);
+	bounds = BoundingVolume::fromPoints(points);
+
 	glGenBuffers(1, &v_vbo);
 	glBindBuffer(GL_ARRAY_BUFFER, v_vbo);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(SpherePlotVertex) * mesh.v.size(),
@@ -74,8 +80,7 @@ void SpherePlot::uploadMeshToGPU(const SpherePlotMesh& mesh)
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glGenBuffers(1, &e_vbo);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, e_vbo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * mesh.e.size(),
-		mesh.e.data(), GL_STATIC_DRAW);
+	elemType = bufferElements(mesh.e);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
 	pos_attrib = shader->getAttribLoc("vPosition");
@@ -100,6 +105,12 @@ void SpherePlot::uploadMeshToGPU(const SpherePlotMesh& mesh)
 	glBindVertexArray(0);
 }
 
+bool SpherePlot::getWorldBounds(BoundingVolume& worldBounds)
+{
+	worldBounds = bounds.transformed(modelToWorld);
+	return true;
+}
+
 void SpherePlot::render()
 {
 	if(!scene) return;
@@ -111,11 +122,9 @@ void SpherePlot::render()
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, e_vbo);
 	
-	glDrawElements(GL_TRIANGLES, numElems, GL_UNSIGNED_SHORT, 0);
+	glDrawElements(GL_TRIANGLES, numElems, elemType, 0);
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
 	glBindVertexArray(0);
-
-	glUseProgram(0);
 }
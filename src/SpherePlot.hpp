@@ -16,7 +16,7 @@ struct SpherePlotVertex
 struct SpherePlotMesh
 {
 	std::vector<SpherePlotVertex> v;
-	std::vector<GLushort>         e;
+	std::vector<GLuint>           e;
 };
 
 struct SphereSample
@@ -45,6 +45,8 @@ public:
 	void render();
 	void update(int dTime) {};
 	Shader* getShader() {return shader;};
+	GLuint getVAO() {return vao;};
+	bool getWorldBounds(BoundingVolume& worldBounds);
 private:
 	template <typename Func>
 	std::vector<SphereSample> takeSamples(
@@ -54,8 +56,10 @@ private:
 	void uploadMeshToGPU(const SpherePlotMesh& mesh);
 
 	Shader* shader;
+	BoundingVolume bounds;
 
 	GLsizei numElems;
+	GLenum elemType;
 
 	GLuint vao;
 	GLuint v_vbo;
@@ -0,0 +1,99 @@
+#include "StreamBuffer.hpp"
+
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+
+namespace
+{
+	const GLuint64 fenceTimeout = 1000000000; // 1s, in ns.
+	const size_t regionAlign = 32;
+}
+
+StreamBuffer::StreamBuffer(GLsizeiptr regionBytes, const void* data)
+	:buffer(0), regionBytes(regionBytes), mapping(0), staging(0), writeRegion(0), drawIndex(0)
+{
+	for(int i = 0; i < nRegions; ++i) fences[i] = 0;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+#ifdef GL_ARB_buffer_storage
+	if(GLEW_ARB_buffer_storage)
+	{
+		const GLbitfield flags =
+			GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, nRegions * regionBytes, 0, flags);
+		mapping = static_cast<char*>(
+			glMapBufferRange(GL_ARRAY_BUFFER, 0, nRegions * regionBytes, flags));
+		if(!mapping)
+		{
+			// Buffer storage is immutable, so start again with a new buffer.
+			std::cout << "!! Could not map stream buffer, falling back to orphaning." << std::endl;
+			glDeleteBuffers(1, &buffer);
+			glGenBuffers(1, &buffer);
+			glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		}
+	}
+#endif
+
+	if(mapping)
+	{
+		memcpy(mapping, data, regionBytes);
+		writeRegion = mapping + regionBytes;
+	}
+	else
+	{
+		glBufferData(GL_ARRAY_BUFFER, regionBytes, data, GL_STREAM_DRAW);
+		staging = new char[regionBytes + regionAlign];
+		writeRegion = staging + (regionAlign - reinterpret_cast<uintptr_t>(staging) % regionAlign);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	for(int i = 0; i < nRegions; ++i)
+		if(fences[i]) glDeleteSync(fences[i]);
+
+	if(mapping)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	glDeleteBuffers(1, &buffer);
+	delete[] staging;
+}
+
+void StreamBuffer::commit(const void* data)
+{
+	if(!mapping)
+	{
+		// Orphan the old storage, so this needn't wait for draws from it.
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, regionBytes, 0, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, regionBytes, data ? data : writeRegion);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return;
+	}
+
+	if(data) memcpy(writeRegion, data, regionBytes);
+
+	// Draws from the retiring region have all been issued, so fence them.
+	fences[drawIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	drawIndex = (drawIndex + 1) % nRegions;
+
+	const int writeIndex = (drawIndex + 1) % nRegions;
+	GLsync& fence = fences[writeIndex];
+	if(fence)
+	{
+		GLenum result;
+		do result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, fenceTimeout);
+		while(result == GL_TIMEOUT_EXPIRED);
+		glDeleteSync(fence);
+		fence = 0;
+	}
+	writeRegion = mapping + writeIndex * regionBytes;
+}
@@ -0,0 +1,59 @@
+#ifndef STREAMBUFFER_HPP
+#define STREAMBUFFER_HPP
+
+#include <GL/glew.h>
+
+/* StreamBuffer
+ * A GL_ARRAY_BUFFER whose contents are rewritten every frame.
+ * Where GL_ARB_buffer_storage is available, the buffer holds nRegions
+ *   regions of regionBytes, persistently mapped. Each frame one region
+ *   is drawn from while the next is written through getWriteRegion(),
+ *   from any thread, so data can be produced straight into the
+ *   buffer with no copy or upload, and without waiting for the GPU.
+ *   commit() fences the region being retired, and waits on the fence
+ *   of the region it hands out for writing, which was last drawn
+ *   nRegions - 1 frames ago.
+ * Otherwise the buffer holds a single region, getWriteRegion() is
+ *   CPU memory, and commit() orphans the buffer and uploads it, so
+ *   the driver need not wait for earlier draws either.
+ * Write regions are aligned to 32 bytes.
+ * Attributes should be set up against region 0; draws then add
+ *   getDrawOffset() (e.g. as glDrawArrays' first vertex).
+ */
+class StreamBuffer
+{
+public:
+	static const int nRegions = 3;
+
+	/* Creates the buffer with data (regionBytes long) as the region
+	 * drawn from first. Must be called on the GL thread. */
+	StreamBuffer(GLsizeiptr regionBytes, const void* data);
+	~StreamBuffer();
+
+	GLuint getBuffer() const {return buffer;};
+	GLsizeiptr getRegionBytes() const {return regionBytes;};
+	bool isPersistent() const {return mapping != 0;};
+
+	/* The region to write the next frame to. */
+	void* getWriteRegion() const {return writeRegion;};
+	/* Makes the frame written since the last commit() the one drawn
+	 * from. If data is not null, it is copied in as that frame first.
+	 * Must be called on the GL thread, after all draws from the
+	 * previous frame have been issued. */
+	void commit(const void* data);
+	/* Byte offset of the region to draw from. */
+	GLintptr getDrawOffset() const {return drawIndex * regionBytes;};
+private:
+	StreamBuffer(const StreamBuffer&);
+	StreamBuffer& operator=(const StreamBuffer&);
+
+	GLuint buffer;
+	GLsizeiptr regionBytes;
+	char* mapping; //Start of the persistent mapping, or 0.
+	char* staging; //Write region if not persistent, unaligned.
+	void* writeRegion;
+	int drawIndex;
+	GLsync fences[nRegions];
+};
+
+#endif
@@ -1,26 +1,42 @@
 #include "Texture.hpp"
 
+#include "TextureUnits.hpp"
+#include "DDS.hpp"
+
 #include "SOIL.h"
+#include <omp.h>
 #include <iostream>
 #include <fstream>
-
-GLuint Texture::nextTexUnit = 0;
+#include <thread>
+#include <cstring>
 
 Texture::Texture(const std::string& filename)
-	:filename(filename)
+	:filename(filename), loaded(true)
 {
 	std::string fullPath = "../textures/" + filename;
 
-	texUnit = genTexUnit();
+	TextureUnits::activateScratch();
 
-	glActiveTexture(GL_TEXTURE0 + texUnit);
+	if(DDS::isDDSFile(filename))
+	{
+		id = 0;
+		try
+		{
+			upload(DDS::read(fullPath));
+		}
+		catch(const TextureFileException& e)
+		{
+			std::cout << e.msg;
+		}
+		return;
+	}
 
 	id = SOIL_load_OGL_texture
 	(		 
 		fullPath.c_str(),
 		SOIL_LOAD_AUTO,
 		SOIL_CREATE_NEW_ID,
-		SOIL_FLAG_INVERT_Y
+		SOIL_FLAG_INVERT_Y | SOIL_FLAG_MIPMAPS
 	);
 
 	if(id == 0) 
@@ -29,73 +45,323 @@ Texture::Texture(const std::string& filename)
 	}
 }
 
+Texture::Texture(const std::string& filename, GLuint placeholder)
+	:filename(filename), loaded(false), id(placeholder)
+{}
+
+void Texture::upload(const unsigned char* data, int width, int height, int channels)
+{
+	TextureUnits::activateScratch();
+
+	GLuint newId = SOIL_create_OGL_texture
+	(
+		data, width, height, channels,
+		SOIL_CREATE_NEW_ID,
+		SOIL_FLAG_INVERT_Y | SOIL_FLAG_MIPMAPS
+	);
+
+	if(newId == 0) 
+	{
+		std::cout << "Texture file ../textures/" + filename + " could not be uploaded.\n";
+		return;
+	}
+
+	id = newId;
+	loaded = true;
+}
+
+void Texture::upload(const CompressedImage& image)
+{
+	TextureUnits::activateScratch();
+
+	GLuint newId;
+	glGenTextures(1, &newId);
+	glBindTexture(GL_TEXTURE_2D, newId);
+
+	int w = image.width, h = image.height;
+	for(unsigned l = 0; l < image.levels.size(); ++l)
+	{
+		glCompressedTexImage2D(GL_TEXTURE_2D, l, image.format, w, h, 0,
+			static_cast<GLsizei>(image.levels[l].size()), image.levels[l].data());
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 
+		static_cast<GLint>(image.levels.size()) - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	id = newId;
+	loaded = true;
+}
+
+std::string Texture::compress(const std::string& filename)
+{
+	std::string fullPath = "../textures/" + filename;
+
+	int width, height, channels;
+	unsigned char* data = SOIL_load_image(
+		fullPath.c_str(), &width, &height, &channels, SOIL_LOAD_AUTO);
+
+	if(!data) throw(TextureFileException(
+		"Texture file " + fullPath + " could not be loaded.\n"));
+
+	/* Flip so that rows are stored bottom-up, as SOIL_FLAG_INVERT_Y would. */
+	std::vector<unsigned char> flipped(width * height * channels);
+	const size_t rowSize = width * channels;
+	for(int v = 0; v < height; ++v)
+		memcpy(flipped.data() + v * rowSize, data + (height - 1 - v) * rowSize, rowSize);
+
+	SOIL_free_image_data(data);
+
+	std::string ddsFilename = filename.substr(0, filename.find_last_of('.')) + ".dds";
+
+	CompressedImage image = DDS::compress(flipped.data(), width, height, channels);
+	DDS::write(image, "../textures/" + ddsFilename);
+
+	std::cout << "Compressed " << fullPath << " to ../textures/" << ddsFilename 
+		<< " (" << image.levels.size() << " mip levels).\n";
+
+	return ddsFilename;
+}
+
 Texture::~Texture()
 {
-	glDeleteTextures(1, &id);
+	if(loaded) 
+	{
+		TextureUnits::release(id);
+		glDeleteTextures(1, &id);
+	}
 }
 
 GLuint Texture::getTexUnit()
 {
-	return texUnit;
+	return TextureUnits::bind(GL_TEXTURE_2D, id);
 }
 
-GLuint Texture::genTexUnit()
+GLuint64 Texture::getHandle()
 {
-	GLuint unit = nextTexUnit;
-	nextTexUnit++;
-	return unit;
+	return TextureUnits::getHandle(id);
 }
 
-ArrayTexture::ArrayTexture(const std::vector<std::string>& filenames)
-	:filenames(filenames)
+ArrayTexture::ArrayTexture(const std::vector<std::string>& filenames, 
+	bool mipmaps)
+	:filenames(filenames), mipmaps(mipmaps)
 {
 	nLayers = filenames.size();
+	if(nLayers == 0) throw(new std::exception());
+
+	TextureUnits::activateScratch();
 
-	texUnit = Texture::genTexUnit();
-	glActiveTexture(GL_TEXTURE0 + texUnit);
+	if(DDS::isDDSFile(filenames[0]))
+	{
+		loadCompressed();
+		return;
+	}
 
+	/* The first layer is decoded up front, as its dimensions
+	 * determine the storage allocated for the whole array. */
 	int width, height, channels;
+	unsigned char* fileData = SOIL_load_image
+		(
+			("../textures/" + filenames[0]).c_str(),
+			&width, &height, &channels,
+			SOIL_LOAD_RGBA
+		);
 
-	std::vector<unsigned char> compiledImages;
+	if(!fileData) throw(new std::exception());
 
-	for(auto f = filenames.begin(); f != filenames.end(); ++f)
+	layerSize = static_cast<size_t>(width) * height * 4;
+	std::vector<unsigned char> compiledImages(layerSize * nLayers);
+	memcpy(compiledImages.data(), fileData, layerSize);
+	SOIL_free_image_data(fileData);
+
+	glGenTextures(1, &id);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, 
+		mipmaps ? DDS::nMipLevels(width, height) : 1, 
+		GL_RGBA8, width, height, nLayers);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	uploadLayer(compiledImages, 0, width, height);
+
+	/* Remaining layers are decoded in parallel into their slot of 
+	 * compiledImages. Thread 0 uploads each layer as soon as it has
+	 * been decoded (GL calls must stay on this thread), and only 
+	 * decodes layers itself if it is the sole thread. */
+	int nextLayer = 1;
+	int nFinished = 1;
+	bool failed = false;
+	std::vector<int> decoded;
+
+	#pragma omp parallel
 	{
-		unsigned char* fileData = SOIL_load_image
-			(
-				("../textures/" + *f).c_str(),
-				&width, &height, &channels,
-				SOIL_LOAD_AUTO
-			);
+		const bool uploader = omp_get_thread_num() == 0;
+		const bool decoder = !uploader || omp_get_num_threads() == 1;
+		bool done = false;
 
-		if(!fileData) throw(new std::exception());
+		while(!done)
+		{
+			if(decoder)
+			{
+				int layer;
+				#pragma omp critical(arrayTexClaim)
+				layer = nextLayer++;
+
+				if(layer < static_cast<int>(nLayers))
+				{
+					bool good = decodeLayer(compiledImages, layer, width, height);
+					#pragma omp critical(arrayTexDecoded)
+					{
+						if(!good) failed = true;
+						decoded.push_back(layer);
+					}
+				}
+				else if(!uploader) done = true;
+			}
 
-		for(int v = 0; v < height; ++v)
-			for(int u = 0; u < width; ++u)
+			if(uploader)
 			{
-				compiledImages.push_back(fileData[(u + v*width)*channels    ]);
-				compiledImages.push_back(fileData[(u + v*width)*channels + 1]);
-				compiledImages.push_back(fileData[(u + v*width)*channels + 2]);
-				compiledImages.push_back(fileData[(u + v*width)*channels + 3]);
+				std::vector<int> ready;
+				bool anyFailed;
+				#pragma omp critical(arrayTexDecoded)
+				{
+					ready.swap(decoded);
+					anyFailed = failed;
+				}
+
+				for(auto l = ready.begin(); l != ready.end(); ++l)
+				{
+					if(!anyFailed) uploadLayer(compiledImages, *l, width, height);
+					++nFinished;
+				}
+
+				if(nFinished == static_cast<int>(nLayers)) done = true;
+				else if(ready.empty() && !decoder) std::this_thread::yield();
 			}
+		}
+	}
 
-		SOIL_free_image_data(fileData);
+	if(failed)
+	{
+		glDeleteTextures(1, &id);
+		throw(new std::exception());
 	}
 
+	if(mipmaps)
+	{
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY,GL_TEXTURE_MIN_FILTER,GL_LINEAR_MIPMAP_LINEAR);
+	}
+	else
+		glTexParameteri(GL_TEXTURE_2D_ARRAY,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+}
+
+void ArrayTexture::loadCompressed()
+{
+	std::vector<CompressedImage> layers(nLayers);
+	bool failed = false;
+
+	#pragma omp parallel for
+	for(int l = 0; l < static_cast<int>(nLayers); ++l)
+	{
+		try
+		{
+			layers[l] = DDS::read("../textures/" + filenames[l]);
+		}
+		catch(const TextureFileException& e)
+		{
+			std::cout << e.msg;
+			failed = true;
+		}
+	}
+
+	if(failed) throw(new std::exception());
+
+	const CompressedImage& first = layers[0];
+	for(auto l = layers.begin(); l != layers.end(); ++l)
+		if(l->width != first.width || l->height != first.height ||
+			l->format != first.format || l->levels.size() != first.levels.size())
+			throw(new std::exception());
+
+	const int nLevels = mipmaps ? static_cast<int>(first.levels.size()) : 1;
+
 	glGenTextures(1, &id);
 	glBindTexture(GL_TEXTURE_2D_ARRAY, id);
-	glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA, width, height, nLayers);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, nLevels, first.format, 
+		first.width, first.height, nLayers);
 
-	glTexImage3D(
-		GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, 
-		width, height, nLayers, 
-		0, GL_RGBA, GL_UNSIGNED_BYTE, 
-		compiledImages.data());
+	for(unsigned layer = 0; layer < nLayers; ++layer)
+	{
+		int w = first.width, h = first.height;
+		for(int level = 0; level < nLevels; ++level)
+		{
+			const std::vector<unsigned char>& data = layers[layer].levels[level];
+			glCompressedTexSubImage3D(
+				GL_TEXTURE_2D_ARRAY, level,
+				0, 0, layer,
+				w, h, 1,
+				first.format, static_cast<GLsizei>(data.size()), data.data());
+			w = w > 1 ? w / 2 : 1;
+			h = h > 1 ? h / 2 : 1;
+		}
+	}
 
-	glTexParameteri(GL_TEXTURE_2D_ARRAY,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY,GL_TEXTURE_MAX_LEVEL, nLevels - 1);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY,GL_TEXTURE_MIN_FILTER,
+		mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D_ARRAY,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
 }
 
+bool ArrayTexture::decodeLayer(std::vector<unsigned char>& compiledImages,
+	int layer, int width, int height)
+{
+	int w, h, channels;
+	unsigned char* fileData = SOIL_load_image
+		(
+			("../textures/" + filenames[layer]).c_str(),
+			&w, &h, &channels,
+			SOIL_LOAD_RGBA
+		);
+
+	if(!fileData) return false;
+
+	bool good = (w == width && h == height);
+	if(good)
+		memcpy(compiledImages.data() + layer * layerSize, fileData, layerSize);
+	else
+		std::cout << "Texture file " + filenames[layer] + 
+			" does not match the size of the other array layers.\n";
+
+	SOIL_free_image_data(fileData);
+	return good;
+}
+
+void ArrayTexture::uploadLayer(const std::vector<unsigned char>& compiledImages,
+	int layer, int width, int height)
+{
+	glTexSubImage3D(
+		GL_TEXTURE_2D_ARRAY, 0,
+		0, 0, layer,
+		width, height, 1,
+		GL_RGBA, GL_UNSIGNED_BYTE,
+		compiledImages.data() + layer * layerSize);
+}
+
 ArrayTexture::~ArrayTexture()
 {
+	TextureUnits::release(id);
 	glDeleteTextures(1, &id);
 }
+
+GLuint ArrayTexture::getTexUnit()
+{
+	return TextureUnits::bind(GL_TEXTURE_2D_ARRAY, id);
+}
+
+GLuint64 ArrayTexture::getHandle()
+{
+	return TextureUnits::getHandle(id);
+}
@@ -7,9 +7,25 @@
 #include <string>
 #include <vector>
 
+struct CompressedImage;
+
+class TextureFileException
+{
+public:
+	TextureFileException(const std::string& msg) {this->msg = msg;};
+	std::string msg;
+};
+
 /* Texture
  * Wraps the loading of an image from a file,
  * and importing it as an OpenGL texture.
+ * getTexUnit() binds the texture (see TextureUnits), so it
+ * should be called just before the draw which uses the unit.
+ * Constructing a Texture loads it synchronously. To stream
+ * it in the background instead, use TextureManager::request().
+ * Images are uploaded with a full mipmap chain. Files ending
+ * in .dds are uploaded directly in their block-compressed 
+ * form; compress() converts an image offline to such a file.
  */
 class Texture
 {
@@ -17,28 +33,52 @@ public:
 	Texture(const std::string& filename);
 	~Texture();
 	GLuint getTexUnit();
+	GLuint64 getHandle();
 	const std::string filename;
-	static GLuint genTexUnit();
+
+	/* Converts ../textures/filename to a DXT compressed, mipmapped
+	 * ../textures/<name>.dds, and returns the new filename.
+	 */
+	static std::string compress(const std::string& filename);
 private:
-	GLuint texUnit;
+	friend class TextureManager;
+	Texture(const std::string& filename, GLuint placeholder);
+	void upload(const unsigned char* data, int width, int height, int channels);
+	void upload(const CompressedImage& image);
+	bool loaded;
 	GLuint id;
-	static GLuint nextTexUnit;
 };
 
 /* ArrayTexture
  * Wraps the loading of a series of 2D textures,
  *   and subsequent conversion into a 2D array texture.
+ * Layers are decoded in parallel and uploaded one at a 
+ *   time as they become ready. All layers must share the
+ *   dimensions of the first.
+ * Arrays have a single level unless mipmaps is set, as arrays
+ *   which hold data rather than images (e.g. PRT coefficients)
+ *   must not be filtered between texels. With mipmaps, the
+ *   compressed mipmaps of .dds layers are uploaded directly,
+ *   otherwise mipmaps are generated.
  */
 class ArrayTexture
 {
 public:
-	ArrayTexture(const std::vector<std::string>& filenames);
+	ArrayTexture(const std::vector<std::string>& filenames, 
+		bool mipmaps = false);
 	~ArrayTexture();
-	GLuint getTexUnit() {return texUnit;};
+	GLuint getTexUnit();
+	GLuint64 getHandle();
 	const std::vector<std::string> filenames;
+	const bool mipmaps;
 private:
+	bool decodeLayer(std::vector<unsigned char>& compiledImages,
+		int layer, int width, int height);
+	void uploadLayer(const std::vector<unsigned char>& compiledImages,
+		int layer, int width, int height);
+	void loadCompressed();
 	size_t nLayers;
-	GLuint texUnit;
+	size_t layerSize;
 	GLuint id;
 };
 
@@ -0,0 +1,179 @@
+#include "TextureManager.hpp"
+
+#include "Texture.hpp"
+#include "TextureUnits.hpp"
+#include "GC.hpp"
+
+#include "SOIL.h"
+
+#include <chrono>
+#include <iostream>
+
+TextureManager::TextureManager()
+	:placeholder(0), nPending(0), stopping(false)
+{
+	int nWorkers = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+	if(nWorkers < 1) nWorkers = 1;
+
+	for(int i = 0; i < nWorkers; ++i)
+		workers.push_back(std::thread(&TextureManager::work, this));
+}
+
+TextureManager::~TextureManager()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	cond.notify_all();
+	for(auto w = workers.begin(); w != workers.end(); ++w)
+		w->join();
+
+	for(auto d = decoded.begin(); d != decoded.end(); ++d)
+		if(d->data) SOIL_free_image_data(d->data);
+}
+
+TextureManager& TextureManager::instance()
+{
+	static TextureManager manager;
+	return manager;
+}
+
+Texture* TextureManager::request(const std::string& filename)
+{
+	TextureManager& m = instance();
+
+	auto found = m.textures.find(filename);
+	if(found != m.textures.end()) return found->second;
+
+	if(m.placeholder == 0)
+	{
+		const unsigned char white[4] = {255, 255, 255, 255};
+		TextureUnits::activateScratch();
+		glGenTextures(1, &m.placeholder);
+		glBindTexture(GL_TEXTURE_2D, m.placeholder);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0,
+			GL_RGBA, GL_UNSIGNED_BYTE, white);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+
+	Texture* tex = new Texture(filename, m.placeholder);
+	m.textures[filename] = tex;
+
+	{
+		std::lock_guard<std::mutex> lock(m.mutex);
+		m.toDecode.push_back(tex);
+		++m.nPending;
+	}
+	m.cond.notify_one();
+
+	return tex;
+}
+
+void TextureManager::update()
+{
+	instance().upload(GC::textureUploadBudget);
+}
+
+void TextureManager::finish()
+{
+	TextureManager& m = instance();
+	while(!idle())
+	{
+		m.upload(-1.0f);
+		std::this_thread::yield();
+	}
+}
+
+bool TextureManager::idle()
+{
+	TextureManager& m = instance();
+	std::lock_guard<std::mutex> lock(m.mutex);
+	return m.nPending == 0;
+}
+
+void TextureManager::work()
+{
+	while(true)
+	{
+		Texture* tex;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while(toDecode.empty() && !stopping)
+				cond.wait(lock);
+			if(stopping) return;
+			tex = toDecode.front();
+			toDecode.pop_front();
+		}
+
+		DecodedImage img;
+		img.tex = tex;
+		img.data = nullptr;
+		img.isCompressed = DDS::isDDSFile(tex->filename);
+
+		if(img.isCompressed)
+		{
+			try
+			{
+				img.compressed = DDS::read("../textures/" + tex->filename);
+			}
+			catch(const TextureFileException& e)
+			{
+				std::cout << e.msg;
+				img.isCompressed = false;
+			}
+		}
+		else
+			img.data = SOIL_load_image(
+				("../textures/" + tex->filename).c_str(),
+				&img.width, &img.height, &img.channels,
+				SOIL_LOAD_AUTO);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		decoded.push_back(img);
+	}
+}
+
+/* Uploads decoded images until budget (ms) is exceeded. At least one 
+ * image is uploaded per call if any are waiting, so loading always
+ * progresses. A negative budget uploads everything available.
+ */
+void TextureManager::upload(float budget)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	while(true)
+	{
+		DecodedImage img;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if(decoded.empty()) return;
+			img = decoded.front();
+			decoded.pop_front();
+		}
+
+		if(img.isCompressed)
+			img.tex->upload(img.compressed);
+		else if(img.data)
+		{
+			img.tex->upload(img.data, img.width, img.height, img.channels);
+			SOIL_free_image_data(img.data);
+		}
+		else
+			std::cout << "Texture file ../textures/" + img.tex->filename +
+				" could not be loaded.\n";
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			--nPending;
+		}
+
+		if(budget >= 0.0f)
+		{
+			std::chrono::duration<float, std::milli> elapsed =
+				std::chrono::high_resolution_clock::now() - start;
+			if(elapsed.count() >= budget) return;
+		}
+	}
+}
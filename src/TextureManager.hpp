@@ -0,0 +1,67 @@
+#ifndef TEXTUREMANAGER_HPP
+#define TEXTUREMANAGER_HPP
+
+#include "DDS.hpp"
+
+#include <GL/glew.h>
+
+#include <string>
+#include <map>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class Texture;
+
+/* TextureManager
+ * Streams textures from ../textures/ in the background.
+ * Images are decoded by a pool of worker threads, and uploaded
+ *   on the GL thread by update(), which stops once its per-frame
+ *   budget (GC::textureUploadBudget ms) has been spent.
+ * A requested Texture may be used straight away: until its upload
+ *   completes it is bound to a 1x1 white placeholder.
+ * Requests are shared, so asking for the same filename twice
+ *   returns the same Texture, which is only decoded once.
+ * The manager owns every Texture it returns.
+ */
+class TextureManager
+{
+public:
+	static Texture* request(const std::string& filename);
+	/* update() is called once per frame by Scene::render() */
+	static void update();
+	/* finish() blocks until every request has been uploaded */
+	static void finish();
+	static bool idle();
+private:
+	struct DecodedImage
+	{
+		Texture* tex;
+		unsigned char* data;
+		int width;
+		int height;
+		int channels;
+		bool isCompressed;
+		CompressedImage compressed;
+	};
+
+	TextureManager();
+	~TextureManager();
+	static TextureManager& instance();
+	void work();
+	void upload(float budget);
+
+	std::map<std::string, Texture*> textures;
+	std::deque<Texture*> toDecode;
+	std::deque<DecodedImage> decoded;
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable cond;
+	GLuint placeholder;
+	int nPending;
+	bool stopping;
+};
+
+#endif
@@ -0,0 +1,153 @@
+#include "TextureUnits.hpp"
+
+#include <iostream>
+
+TextureUnits::TextureUnits()
+	:scratchUnit(0), activeUnit(0), useCounter(0), backend(BIND_UNITS)
+{
+	frameStats.binds = frameStats.activeUnits = frameStats.hits = 0;
+	lastStats = frameStats;
+}
+
+TextureUnits& TextureUnits::instance()
+{
+	static TextureUnits manager;
+	if(manager.units.empty()) manager.init();
+	return manager;
+}
+
+void TextureUnits::init()
+{
+	GLint maxUnits = 0;
+	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxUnits);
+	if(maxUnits < 2) maxUnits = 2;
+
+	scratchUnit = static_cast<GLuint>(maxUnits - 1);
+
+	Unit empty;
+	empty.target = GL_TEXTURE_2D;
+	empty.id = 0;
+	empty.lastUse = 0;
+	units.assign(scratchUnit, empty);
+
+	GLint active = GL_TEXTURE0;
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &active);
+	activeUnit = static_cast<GLuint>(active - GL_TEXTURE0);
+}
+
+GLuint TextureUnits::bind(GLenum target, GLuint id)
+{
+	TextureUnits& m = instance();
+	++m.useCounter;
+
+	auto found = m.unitOf.find(id);
+	if(found != m.unitOf.end() && m.units[found->second].target == target)
+	{
+		m.units[found->second].lastUse = m.useCounter;
+		++m.frameStats.hits;
+		return found->second;
+	}
+
+	/* Evict the least recently used unit. */
+	GLuint lru = 0;
+	for(GLuint u = 1; u < m.units.size(); ++u)
+		if(m.units[u].lastUse < m.units[lru].lastUse) lru = u;
+
+	Unit& unit = m.units[lru];
+	if(unit.id != 0) m.unitOf.erase(unit.id);
+	if(found != m.unitOf.end()) 
+	{
+		m.units[found->second].id = 0;
+		m.units[found->second].lastUse = 0;
+		m.unitOf.erase(found);
+	}
+
+	if(m.activeUnit != lru)
+	{
+		glActiveTexture(GL_TEXTURE0 + lru);
+		m.activeUnit = lru;
+		++m.frameStats.activeUnits;
+	}
+	glBindTexture(target, id);
+	++m.frameStats.binds;
+
+	unit.target = target;
+	unit.id = id;
+	unit.lastUse = m.useCounter;
+	m.unitOf[id] = lru;
+
+	return lru;
+}
+
+void TextureUnits::release(GLuint id)
+{
+	TextureUnits& m = instance();
+
+	auto found = m.unitOf.find(id);
+	if(found != m.unitOf.end())
+	{
+		m.units[found->second].id = 0;
+		m.units[found->second].lastUse = 0;
+		m.unitOf.erase(found);
+	}
+
+	auto handle = m.handles.find(id);
+	if(handle != m.handles.end())
+	{
+		glMakeTextureHandleNonResidentARB(handle->second);
+		m.handles.erase(handle);
+	}
+}
+
+void TextureUnits::activateScratch()
+{
+	TextureUnits& m = instance();
+	if(m.activeUnit != m.scratchUnit)
+	{
+		glActiveTexture(GL_TEXTURE0 + m.scratchUnit);
+		m.activeUnit = m.scratchUnit;
+		++m.frameStats.activeUnits;
+	}
+}
+
+void TextureUnits::beginFrame()
+{
+	TextureUnits& m = instance();
+	m.lastStats = m.frameStats;
+	m.frameStats.binds = m.frameStats.activeUnits = m.frameStats.hits = 0;
+}
+
+const TextureBindStats& TextureUnits::getStats()
+{
+	return instance().lastStats;
+}
+
+void TextureUnits::setBackend(TextureBackend backend)
+{
+	TextureUnits& m = instance();
+	if(backend == BINDLESS && !GLEW_ARB_bindless_texture)
+	{
+		std::cout << "Warning: Bindless textures unsupported, binding to units instead.\n";
+		backend = BIND_UNITS;
+	}
+	m.backend = backend;
+}
+
+TextureBackend TextureUnits::getBackend()
+{
+	return instance().backend;
+}
+
+GLuint64 TextureUnits::getHandle(GLuint id)
+{
+	TextureUnits& m = instance();
+	if(m.backend != BINDLESS) return 0;
+
+	auto found = m.handles.find(id);
+	if(found != m.handles.end()) return found->second;
+
+	GLuint64 handle = glGetTextureHandleARB(id);
+	glMakeTextureHandleResidentARB(handle);
+	m.handles[id] = handle;
+	return handle;
+}
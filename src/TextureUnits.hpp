@@ -0,0 +1,75 @@
+#ifndef TEXTUREUNITS_HPP
+#define TEXTUREUNITS_HPP
+
+#include <GL/glew.h>
+
+#include <vector>
+#include <map>
+
+/* Texture binding backends
+ * BIND_UNITS: Textures are bound to texture units on demand.
+ * BINDLESS: Textures are also made resident and may be passed to 
+ *   shaders as 64-bit handles (requires GL_ARB_bindless_texture,
+ *   and shaders declaring the extension). Falls back to BIND_UNITS 
+ *   where unsupported.
+ */
+enum TextureBackend : char {BIND_UNITS, BINDLESS};
+
+struct TextureBindStats
+{
+	int binds;         //glBindTexture calls made.
+	int activeUnits;   //glActiveTexture calls made.
+	int hits;          //Binds skipped as the texture was already bound.
+};
+
+/* TextureUnits
+ * Assigns texture units to textures at draw time. Texture units 
+ *   hold a least-recently-used cache of current bindings, so that
+ *   binding a texture which is already bound costs no GL calls, 
+ *   and the units used by a single draw never evict one another.
+ * The final texture unit is reserved as a scratch unit for texture
+ *   creation and uploads, and is never handed out by bind().
+ * Call beginFrame() once per frame (Scene::render() does this); 
+ *   getStats() then reports the binds made in the previous frame.
+ */
+class TextureUnits
+{
+public:
+	/* Binds texture id to some unit, and returns that unit. */
+	static GLuint bind(GLenum target, GLuint id);
+	/* Forget any binding of id (call when deleting a texture). */
+	static void release(GLuint id);
+	/* Makes the scratch unit active, ready for texture creation. */
+	static void activateScratch();
+	static void beginFrame();
+	static const TextureBindStats& getStats();
+
+	static void setBackend(TextureBackend backend);
+	static TextureBackend getBackend();
+	/* Returns a resident bindless handle for id, or 0 if the 
+	 * BINDLESS backend is not in use. */
+	static GLuint64 getHandle(GLuint id);
+private:
+	struct Unit
+	{
+		GLenum target;
+		GLuint id;
+		unsigned lastUse;
+	};
+
+	TextureUnits();
+	static TextureUnits& instance();
+	void init();
+
+	std::vector<Unit> units;
+	std::map<GLuint, GLuint> unitOf;
+	std::map<GLuint, GLuint64> handles;
+	GLuint scratchUnit;
+	GLuint activeUnit;
+	unsigned useCounter;
+	TextureBackend backend;
+	TextureBindStats frameStats;
+	TextureBindStats lastStats;
+};
+
+#endif
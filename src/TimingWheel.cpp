@@ -0,0 +1,55 @@
+#include "TimingWheel.hpp"
+
+#include <algorithm>
+
+TimingWheel::TimingWheel(int slotTime, int nSlots)
+	:slotTime(slotTime), mask(nSlots - 1),
+	 time(0), nextSlot(1), nEvents(0), slots(nSlots)
+{}
+
+void TimingWheel::clear(int now)
+{
+	for(auto s = slots.begin(); s != slots.end(); ++s) s->clear();
+	time = now;
+	nextSlot = now / slotTime + 1;
+	nEvents = 0;
+}
+
+/* Slot n holds events due in ((n - 1) * slotTime, n * slotTime], so
+ * every event in the slots advance() passes the end of is due. */
+void TimingWheel::schedule(int due, unsigned id)
+{
+	const int slot = std::min(std::max((due + slotTime - 1) / slotTime, nextSlot),
+		nextSlot + mask);
+
+	Event e;
+	e.due = due;
+	e.id = id;
+	slots[slot & mask].push_back(e);
+	++nEvents;
+}
+
+void TimingWheel::advance(int now, std::vector<Event>& due)
+{
+	// Including the slot now falls within, if any.
+	const int lastSlot = (now + slotTime - 1) / slotTime;
+	const int nVisit = std::min(lastSlot - nextSlot + 1, mask + 1);
+
+	for(int i = 0; i < nVisit; ++i)
+	{
+		std::vector<Event>& slot = slots[(nextSlot + i) & mask];
+		for(auto e = slot.begin(); e != slot.end(); ++e)
+			if(e->due <= now) due.push_back(*e);
+			else later.push_back(*e);
+		nEvents -= static_cast<int>(slot.size());
+		slot.clear();
+	}
+
+	/* Events not yet due, from the slot now falls within or beyond the
+	 * wheel's span, are put back once time has moved. */
+	time = now;
+	nextSlot = std::max(nextSlot, now / slotTime + 1);
+	for(auto e = later.begin(); e != later.end(); ++e)
+		schedule(e->due, e->id);
+	later.clear();
+}
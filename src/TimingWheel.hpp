@@ -0,0 +1,51 @@
+#ifndef TIMINGWHEEL_HPP
+#define TIMINGWHEEL_HPP
+
+#include <vector>
+
+/* TimingWheel
+ * A queue of events keyed by absolute time in ms, for scheduling
+ *   many timers that rarely fire, e.g. particle respawns, without
+ *   checking each of them every step.
+ * Events are bucketed into nSlots slots of slotTime ms, reused round
+ *   the wheel, so scheduling is O(1) and advancing only visits the
+ *   slots passed. Events further ahead than the wheel spans are put
+ *   in its last slot, and rescheduled when it comes round. Times
+ *   must not be negative.
+ * Events cannot be cancelled; the owner should tag them so that
+ *   stale ones can be recognised and ignored as they fall due.
+ */
+class TimingWheel
+{
+public:
+	struct Event
+	{
+		int due;
+		unsigned id;
+	};
+
+	/* nSlots must be a power of two. */
+	TimingWheel(int slotTime, int nSlots);
+
+	/* Drops every event, and sets the time to now. */
+	void clear(int now);
+	/* Events due at or before the current time fall due at the next
+	 * advance(). */
+	void schedule(int due, unsigned id);
+	/* Moves time forward to now, appending every event due by then
+	 * to due, in no particular order. */
+	void advance(int now, std::vector<Event>& due);
+
+	int getTime() const {return time;};
+	int getNEvents() const {return nEvents;};
+private:
+	const int slotTime;
+	const int mask;
+	int time;
+	int nextSlot; //First slot advance() has yet to visit.
+	int nEvents;
+	std::vector<std::vector<Event> > slots;
+	std::vector<Event> later; //Visited events not yet due.
+};
+
+#endif
@@ -0,0 +1,163 @@
+#include "UpdateGraph.hpp"
+
+#include "Renderable.hpp"
+#include "GC.hpp"
+
+#include <map>
+#include <algorithm>
+#include <iostream>
+
+UpdateGraph::UpdateGraph()
+	:nRemaining(0), nRunning(0), dTime(0), cycleReported(false), stopping(false)
+{
+	nThreads = GC::updateThreads > 0 ? GC::updateThreads :
+		static_cast<int>(std::thread::hardware_concurrency());
+	if(nThreads < 1) nThreads = 1;
+
+	//The thread calling run() works too, but not one calling start().
+	for(int i = 0; i < std::max(nThreads - 1, 1); ++i)
+		workers.push_back(std::thread(&UpdateGraph::work, this));
+}
+
+UpdateGraph::~UpdateGraph()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	cond.notify_all();
+	for(auto w = workers.begin(); w != workers.end(); ++w)
+		w->join();
+}
+
+void UpdateGraph::run(const std::vector<Renderable*>& renderables, int dTime)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while(nRemaining > 0) cond.wait(lock);
+	this->dTime = dTime;
+	buildNodes(renderables);
+	if(nRemaining == 0) return;
+
+	cond.notify_all();
+	runNodes(lock, false);
+}
+
+void UpdateGraph::start(const std::vector<Renderable*>& renderables, int dTime)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while(nRemaining > 0) cond.wait(lock);
+	this->dTime = dTime;
+	buildNodes(renderables);
+	if(nRemaining > 0) cond.notify_all();
+}
+
+void UpdateGraph::wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while(nRemaining > 0) cond.wait(lock);
+}
+
+bool UpdateGraph::busy()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return nRemaining > 0;
+}
+
+void UpdateGraph::buildNodes(const std::vector<Renderable*>& renderables)
+{
+	nodes.clear();
+	ready.clear();
+
+	std::map<Renderable*, int> index;
+	for(auto r = renderables.begin(); r != renderables.end(); ++r)
+	{
+		Node n = {*r, 0, std::vector<int>()};
+		index[*r] = static_cast<int>(nodes.size());
+		nodes.push_back(n);
+	}
+
+	std::vector<Renderable*> deps;
+	for(size_t i = 0; i < nodes.size(); ++i)
+	{
+		deps.clear();
+		nodes[i].r->getUpdateDeps(deps);
+		for(auto d = deps.begin(); d != deps.end(); ++d)
+		{
+			auto dep = index.find(*d);
+			if(dep == index.end() || dep->second == static_cast<int>(i)) continue;
+			nodes[dep->second].dependents.push_back(static_cast<int>(i));
+			++nodes[i].nDeps;
+		}
+	}
+
+	/* Find the nodes reachable in dependency order. Any left over
+	 * lie on a cycle, so lose their dependencies. */
+	std::vector<int> nDeps(nodes.size());
+	std::vector<int> order;
+	for(size_t i = 0; i < nodes.size(); ++i)
+	{
+		nDeps[i] = nodes[i].nDeps;
+		if(nDeps[i] == 0) order.push_back(static_cast<int>(i));
+	}
+	for(size_t o = 0; o < order.size(); ++o)
+	{
+		const std::vector<int>& dependents = nodes[order[o]].dependents;
+		for(auto d = dependents.begin(); d != dependents.end(); ++d)
+			if(--nDeps[*d] == 0) order.push_back(*d);
+	}
+	if(order.size() < nodes.size())
+	{
+		if(!cycleReported)
+			std::cout << "!! Cyclic update dependencies between "
+				<< nodes.size() - order.size() << " renderables.\n";
+		cycleReported = true;
+		for(size_t i = 0; i < nodes.size(); ++i)
+			if(nDeps[i] > 0) nodes[i].nDeps = 0;
+	}
+
+	for(size_t i = 0; i < nodes.size(); ++i)
+		if(nodes[i].nDeps == 0) ready.push_back(static_cast<int>(i));
+
+	nRemaining = static_cast<int>(nodes.size());
+	nRunning = 0;
+}
+
+void UpdateGraph::work()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	runNodes(lock, true);
+}
+
+void UpdateGraph::runNodes(std::unique_lock<std::mutex>& lock, bool wait)
+{
+	while(true)
+	{
+		if(ready.empty())
+		{
+			if(wait ? stopping : nRemaining == 0) return;
+			cond.wait(lock);
+			continue;
+		}
+
+		int n = ready.front();
+		ready.pop_front();
+		++nRunning;
+
+		/* Split the cores between the updates now running or ready. */
+		Renderable* r = nodes[n].r;
+		r->updateThreads = std::max(1,
+			nThreads / (nRunning + static_cast<int>(ready.size())));
+
+		lock.unlock();
+		r->update(dTime);
+		lock.lock();
+
+		--nRunning;
+		--nRemaining;
+		const std::vector<int>& dependents = nodes[n].dependents;
+		for(auto d = dependents.begin(); d != dependents.end(); ++d)
+			if(--nodes[*d].nDeps == 0) ready.push_back(*d);
+		if(!dependents.empty() || nRemaining == 0)
+			cond.notify_all();
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef UPDATEGRAPH_HPP
+#define UPDATEGRAPH_HPP
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class Renderable;
+
+/* UpdateGraph
+ * Calls update() on a set of renderables in parallel, using a pool
+ *   of worker threads together with the calling thread.
+ * A renderable's update() starts only once those of the renderables
+ *   it lists in getUpdateDeps() have finished, e.g. particle lights
+ *   wait on the object they light. Dependencies on renderables not
+ *   being updated are ignored, and cycles are broken with a warning.
+ * Each renderable's updateThreads is set to its share of the cores
+ *   before update() is called, so parallel loops within updates
+ *   (see AdvectParticles::update()) do not oversubscribe the CPU.
+ * start() leaves the updates to the workers and returns at once, so
+ *   the caller can render meanwhile; wait() is the matching sync
+ *   point, and must be reached before the renderables are touched.
+ */
+class UpdateGraph
+{
+public:
+	UpdateGraph();
+	~UpdateGraph();
+	/* Blocks until every renderable has been updated. */
+	void run(const std::vector<Renderable*>& renderables, int dTime);
+	void start(const std::vector<Renderable*>& renderables, int dTime);
+	void wait();
+	bool busy();
+	int getNThreads() const {return nThreads;};
+private:
+	struct Node
+	{
+		Renderable* r;
+		int nDeps; //Dependencies yet to finish.
+		std::vector<int> dependents;
+	};
+
+	void buildNodes(const std::vector<Renderable*>& renderables);
+	void work();
+	/* Runs ready nodes until none remain, or until stopping if wait. */
+	void runNodes(std::unique_lock<std::mutex>& lock, bool wait);
+
+	std::vector<Node> nodes;
+	std::deque<int> ready;
+	int nRemaining;
+	int nRunning;
+	int dTime;
+	int nThreads;
+	bool cycleReported;
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable cond;
+	bool stopping;
+};
+
+#endif
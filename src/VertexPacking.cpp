@@ -0,0 +1,112 @@
+#include "VertexPacking.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+VertexPacking::Bounds VertexPacking::bounds(const std::vector<glm::vec4>& verts)
+{
+	Bounds b;
+	b.offset = glm::vec3(0.0f);
+	b.scale = glm::vec3(1.0f);
+	if(verts.empty()) return b;
+
+	glm::vec3 minV(verts[0]), maxV(verts[0]);
+	for(auto v = verts.begin(); v != verts.end(); ++v)
+	{
+		minV = glm::min(minV, glm::vec3(*v));
+		maxV = glm::max(maxV, glm::vec3(*v));
+	}
+
+	b.offset = minV;
+	b.scale = maxV - minV;
+	for(int i = 0; i < 3; ++i)
+		if(b.scale[i] <= 0.0f) b.scale[i] = 1.0f; // Flat in this axis.
+
+	return b;
+}
+
+void VertexPacking::packPosition(const glm::vec4& v, const Bounds& b, GLushort out[4])
+{
+	for(int i = 0; i < 3; ++i)
+	{
+		float u = (v[i] - b.offset[i]) / b.scale[i];
+		u = std::min(std::max(u, 0.0f), 1.0f);
+		out[i] = static_cast<GLushort>(floor(u * 65535.0f + 0.5f));
+	}
+	out[3] = 65535;
+}
+
+void VertexPacking::packNormal(const glm::vec3& n, GLshort out[2])
+{
+	float l1 = fabs(n.x) + fabs(n.y) + fabs(n.z);
+	if(l1 < 1e-20f)
+	{
+		out[0] = out[1] = 0;
+		return;
+	}
+
+	float x = n.x / l1;
+	float y = n.y / l1;
+
+	/* Fold the lower hemisphere over the diagonals. */
+	if(n.z < 0.0f)
+	{
+		float ox = x;
+		x = (1.0f - fabs(y))  * (ox >= 0.0f ? 1.0f : -1.0f);
+		y = (1.0f - fabs(ox)) * (y  >= 0.0f ? 1.0f : -1.0f);
+	}
+
+	out[0] = static_cast<GLshort>(floor(std::min(std::max(x, -1.0f), 1.0f) * 32767.0f + 0.5f));
+	out[1] = static_cast<GLshort>(floor(std::min(std::max(y, -1.0f), 1.0f) * 32767.0f + 0.5f));
+}
+
+void VertexPacking::packTexCoord(const glm::vec2& t, GLhalf out[2])
+{
+	out[0] = packHalf(t.x);
+	out[1] = packHalf(t.y);
+}
+
+GLhalf VertexPacking::packHalf(float f)
+{
+	uint32_t x;
+	memcpy(&x, &f, sizeof(float));
+
+	uint32_t sign = (x >> 16) & 0x8000;
+	int exp = static_cast<int>((x >> 23) & 0xff);
+	uint32_t mant = x & 0x7fffff;
+
+	if(exp == 0xff) // Inf or NaN
+		return static_cast<GLhalf>(sign | 0x7c00 | (mant ? 0x200 : 0));
+
+	exp = exp - 127 + 15;
+
+	if(exp >= 31) // Overflow to inf
+		return static_cast<GLhalf>(sign | 0x7c00);
+
+	if(exp <= 0) // Denormal or zero
+	{
+		if(exp < -10) return static_cast<GLhalf>(sign);
+		mant |= 0x800000;
+		int shift = 14 - exp;
+		uint32_t half = mant >> shift;
+		if((mant >> (shift - 1)) & 1) ++half;
+		return static_cast<GLhalf>(sign | half);
+	}
+
+	uint32_t half = sign | (exp << 10) | (mant >> 13);
+	if(mant & 0x1000) ++half; // Round, carrying into the exponent if needed.
+	return static_cast<GLhalf>(half);
+}
+
+void VertexPacking::reportSaving(const std::string& name, size_t nVerts,
+	size_t packedSize, size_t unpackedSize)
+{
+	std::cout << "> " << name << " vertex buffer: "
+		<< (nVerts * packedSize) / 1024 << "KB packed ("
+		<< packedSize << " bytes/vertex), "
+		<< (nVerts * unpackedSize) / 1024 << "KB unpacked ("
+		<< unpackedSize << " bytes/vertex).\n";
+}
@@ -0,0 +1,42 @@
+#ifndef VERTEXPACKING_HPP
+#define VERTEXPACKING_HPP
+
+#include <glm.hpp>
+#include <GL/glew.h>
+
+#include <vector>
+#include <string>
+
+/* VertexPacking
+ * Conversions used to build packed vertex buffers:
+ *   positions quantised to 16-bit unsigned values within the
+ *   mesh's AABB, normals as 16-bit octahedral encodings, and
+ *   tex coords as half floats.
+ * Shaders decode these when their packedVerts uniform is set
+ *   (see Shader::setPackedVerts()): position = posOffset +
+ *   vPosition.xyz * posScale, and normal = octDecode(vNorm.xy).
+ * Packing is off by default (GC::packVertices) as the smaller
+ *   buffers have not yet been shown to draw faster; running
+ *   fire-framework -v times packed against unpacked draws.
+ */
+namespace VertexPacking
+{
+	struct Bounds
+	{
+		glm::vec3 offset; // AABB min corner
+		glm::vec3 scale;  // AABB extent
+	};
+
+	Bounds bounds(const std::vector<glm::vec4>& verts);
+
+	void packPosition(const glm::vec4& v, const Bounds& b, GLushort out[4]);
+	void packNormal(const glm::vec3& n, GLshort out[2]);
+	void packTexCoord(const glm::vec2& t, GLhalf out[2]);
+	GLhalf packHalf(float f);
+
+	/* Prints the size of a vertex buffer, packed and unpacked. */
+	void reportSaving(const std::string& name, size_t nVerts,
+		size_t packedSize, size_t unpackedSize);
+}
+
+#endif